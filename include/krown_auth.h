@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * @brief Structure pour stocker les informations de clé SSH
@@ -24,7 +25,12 @@ typedef enum {
     KROWN_AUTH_ERROR_PERMISSIONS = -3,
     KROWN_AUTH_ERROR_OPENSSH_NOT_FOUND = -4,
     KROWN_AUTH_ERROR_READ_KEY = -5,
-    KROWN_AUTH_ERROR_MEMORY = -6
+    KROWN_AUTH_ERROR_MEMORY = -6,
+    KROWN_AUTH_ERROR_AGENT = -7,
+    KROWN_AUTH_ERROR_CERT = -8,
+    KROWN_AUTH_ERROR_TIMEOUT = -9,
+    KROWN_AUTH_ERROR_KEY_MISMATCH = -10,
+    KROWN_AUTH_ERROR_KEY_EXISTS = -11
 } krown_auth_result_t;
 
 /**
@@ -32,9 +38,95 @@ typedef enum {
  */
 typedef enum {
     KROWN_KEY_ED25519 = 0,
-    KROWN_KEY_RSA_4096 = 1
+    KROWN_KEY_RSA_4096 = 1,
+    KROWN_KEY_ECDSA_P256 = 2
 } krown_key_type_t;
 
+/**
+ * @brief Identité SSH chargée en mémoire, prête à être envoyée à ssh-agent
+ *
+ * Remplie par krown_load_identity() ou krown_load_identity_file(),
+ * libérée par krown_identity_cleanup().
+ */
+typedef struct {
+    krown_key_type_t key_type;
+    unsigned char *key_blob;      /* Type + champs privés + commentaire (format agent) */
+    size_t key_blob_len;
+    unsigned char *public_blob;   /* Clé publique au format wire SSH */
+    size_t public_blob_len;
+} krown_identity_t;
+
+/**
+ * @brief Contraintes appliquées aux identités ajoutées à ssh-agent
+ */
+typedef struct {
+    unsigned int lifetime;        /* Durée de vie en secondes (0 = illimitée) */
+    bool confirm;                 /* Demander une confirmation à chaque utilisation */
+} krown_agent_constraints_t;
+
+/**
+ * @brief Stratégies d'obtention de la clé, de la moins coûteuse à la plus coûteuse
+ */
+typedef enum {
+    KROWN_STRATEGY_NONE = 0,
+    KROWN_STRATEGY_EXISTING = 1 << 0,   /* Clé déjà présente et lisible dans ~/.ssh */
+    KROWN_STRATEGY_POOL = 1 << 1,       /* Clé pré-générée prise dans un dossier de pool */
+    KROWN_STRATEGY_DERIVED = 1 << 2,    /* Clé ED25519 dérivée d'un seed maître */
+    KROWN_STRATEGY_ED25519 = 1 << 3,    /* ssh-keygen -t ed25519 */
+    KROWN_STRATEGY_ECDSA = 1 << 4,      /* ssh-keygen -t ecdsa -b 256 */
+    KROWN_STRATEGY_RSA = 1 << 5,        /* ssh-keygen -t rsa -b 4096 */
+    KROWN_STRATEGY_ALL = 0x3f
+} krown_strategy_t;
+
+/**
+ * @brief Phases de prepare_vm_for_krown_ex() (masque de bits du rapport)
+ */
+typedef enum {
+    KROWN_PHASE_SSH_DIR = 1 << 0,       /* ~/.ssh créé avec les bonnes permissions */
+    KROWN_PHASE_KEY = 1 << 1,           /* Clé disponible */
+    KROWN_PHASE_PERMISSIONS = 1 << 2,   /* Permissions des clés corrigées */
+    KROWN_PHASE_PUBLIC_KEY = 1 << 3,    /* Chemin de la clé publique exposé */
+    KROWN_PHASE_IDENTITY = 1 << 4       /* Clé privée remise dans options->identity */
+} krown_phase_t;
+
+/**
+ * @brief Options de prepare_vm_for_krown_ex()
+ */
+typedef struct {
+    uint64_t deadline_ms;               /* Échéance absolue (krown_monotonic_ms()), 0 = aucune */
+    unsigned int strategies;            /* Masque de krown_strategy_t autorisées (0 = toutes) */
+    const char *pool_dir;               /* Dossier de paires pré-générées (<nom>, <nom>.pub) ou NULL */
+    const char *seed_path;              /* Seed maître pour KROWN_STRATEGY_DERIVED ou NULL */
+    const char *vm_id;                  /* Identifiant de la VM pour KROWN_STRATEGY_DERIVED */
+    bool force;                         /* Remplace les fichiers de clé déjà présents */
+    krown_identity_t *identity;         /* Reçoit la clé préparée, pour krown_agent_add() (NULL = non) */
+} krown_prepare_options_t;
+
+/**
+ * @brief Compte rendu de prepare_vm_for_krown_ex(), rempli même en cas d'échec
+ */
+typedef struct {
+    krown_strategy_t strategy;          /* Stratégie ayant fourni la clé (NONE si aucune) */
+    krown_key_type_t key_type;          /* Type de la clé obtenue */
+    unsigned int completed_phases;      /* Masque de krown_phase_t terminées */
+    unsigned int skipped_strategies;    /* Stratégies écartées faute de budget */
+    unsigned int failed_strategies;     /* Stratégies tentées sans succès (ou annulées) */
+    uint64_t elapsed_ms;                /* Durée totale */
+} krown_prepare_report_t;
+
+/**
+ * @brief Paramètres d'émission des certificats utilisateur OpenSSH
+ */
+typedef struct {
+    const char *ca_key_path;          /* Clé privée de la CA (ED25519, non chiffrée) */
+    const char *key_id;               /* Identifiant du certificat (NULL = commentaire de la clé) */
+    const char *const *principals;    /* Principaux autorisés (noms d'utilisateur) */
+    size_t principal_count;           /* Au moins 1 (0 est refusé : certificat valable pour tous) */
+    uint64_t valid_after;             /* Début de validité (secondes epoch, 0 = toujours) */
+    uint64_t valid_before;            /* Fin de validité (secondes epoch, 0 = jamais) */
+    uint64_t serial;                  /* Numéro de série (incrémenté pour chaque clé d'un lot) */
+} krown_cert_options_t;
+
 /**
  * @brief Vérifie si une paire de clés SSH existe déjà
  * 
@@ -107,6 +199,168 @@ krown_auth_result_t krown_ensure_ssh_directory(void);
  */
 krown_auth_result_t prepare_vm_for_krown(char *public_key_path, size_t path_size);
 
+/**
+ * @brief Charge en mémoire la clé privée de l'utilisateur courant (~/.ssh)
+ * 
+ * Après prepare_vm_for_krown_ex(), préférer options->identity : la clé est remise
+ * sans relire le fichier.
+ * 
+ * @param key_type Type de clé à charger
+ * @param identity Identité à remplir (à libérer avec krown_identity_cleanup())
+ * @return krown_auth_result_t Code de retour
+ */
+krown_auth_result_t krown_load_identity(krown_key_type_t key_type, krown_identity_t *identity);
+
+/**
+ * @brief Charge en mémoire une clé privée OpenSSH non chiffrée
+ * 
+ * Permet de charger les clés d'autres utilisateurs ou d'autres VM pour un ajout groupé.
+ * 
+ * @param private_key_path Chemin de la clé privée
+ * @param identity Identité à remplir (à libérer avec krown_identity_cleanup())
+ * @return krown_auth_result_t Code de retour
+ */
+krown_auth_result_t krown_load_identity_file(const char *private_key_path, krown_identity_t *identity);
+
+/**
+ * @brief Ajoute des identités à ssh-agent via $SSH_AUTH_SOCK
+ * 
+ * Parle directement le protocole de l'agent (pas de fork de ssh-add) et envoie
+ * toutes les identités sur une seule connexion.
+ * 
+ * @param identities Tableau d'identités à ajouter
+ * @param count Nombre d'identités
+ * @param constraints Contraintes de durée de vie / confirmation (peut être NULL)
+ * @return krown_auth_result_t Code de retour (KROWN_AUTH_ERROR_AGENT si l'agent refuse ou est injoignable)
+ */
+krown_auth_result_t krown_agent_add(const krown_identity_t *identities, size_t count,
+                                    const krown_agent_constraints_t *constraints);
+
+/**
+ * @brief Efface et libère une identité chargée en mémoire
+ * 
+ * @param identity Identité à libérer (peut être NULL)
+ */
+void krown_identity_cleanup(krown_identity_t *identity);
+
+/**
+ * @brief Dérive la clé ED25519 d'une VM à partir d'un seed maître (mode sans état)
+ * 
+ * seed Ed25519 = HKDF-SHA256(seed maître, info = vm_id). N'importe quel nœud disposant
+ * du seed maître peut recalculer la même paire de clés : rien à sauvegarder ni synchroniser.
+ * Écrit ~/.ssh/id_ed25519 et ~/.ssh/id_ed25519.pub sans appeler ssh-keygen.
+ * 
+ * @param seed_path Fichier du seed maître (au moins 32 octets, permissions 600)
+ * @param vm_id Identifiant de la VM (sert aussi de commentaire de la clé)
+ * Le seed est toujours lu et validé. Si ~/.ssh/id_ed25519 existe déjà, elle doit être
+ * la clé dérivée (sa clé publique est recalculée si elle manque) ; sinon
+ * KROWN_AUTH_ERROR_KEY_MISMATCH est retourné et la clé existante est conservée.
+ * 
+ * @param force Si true, remplace les clés existantes au lieu de les vérifier
+ * @return krown_auth_result_t Code de retour
+ */
+krown_auth_result_t krown_derive_ed25519_keys(const char *seed_path, const char *vm_id, bool force);
+
+/**
+ * @brief Dérive la paire de clés ED25519 d'une VM vers un chemin donné
+ * 
+ * @param seed_path Fichier du seed maître
+ * @param vm_id Identifiant de la VM
+ * @param private_key_path Chemin de la clé privée (la clé publique est écrite dans <chemin>.pub)
+ * @param force Si true, remplace une clé existante ; sinon elle doit être la clé dérivée
+ *              (KROWN_AUTH_ERROR_KEY_MISMATCH sinon, fichier conservé)
+ * @return krown_auth_result_t Code de retour
+ */
+krown_auth_result_t krown_derive_ed25519_key_file(const char *seed_path, const char *vm_id,
+                                                  const char *private_key_path, bool force);
+
+/**
+ * @brief Calcule la clé publique dérivée d'une VM sans accéder à son disque
+ * 
+ * @param seed_path Fichier du seed maître
+ * @param vm_id Identifiant de la VM
+ * @param buffer Buffer pour la ligne "ssh-ed25519 AAAA... vm_id" (256 octets suffisent)
+ * @param buffer_size Taille du buffer
+ * @return krown_auth_result_t Code de retour
+ */
+krown_auth_result_t krown_derive_public_key(const char *seed_path, const char *vm_id,
+                                            char *buffer, size_t buffer_size);
+
+/**
+ * @brief Calcule en lot les clés publiques dérivées de plusieurs VM
+ * 
+ * Le seed maître n'est lu qu'une fois pour tout le lot.
+ * 
+ * @param seed_path Fichier du seed maître
+ * @param vm_ids Identifiants des VM
+ * @param count Nombre de VM
+ * @param buffers Un buffer par VM pour la ligne de clé publique
+ * @param buffer_size Taille de chaque buffer
+ * @return krown_auth_result_t Code de retour (s'arrête à la première erreur)
+ */
+krown_auth_result_t krown_derive_public_keys(const char *seed_path, const char *const *vm_ids, size_t count,
+                                             char **buffers, size_t buffer_size);
+
+/**
+ * @brief Signe la clé publique de la VM en certificat utilisateur OpenSSH
+ * 
+ * Signature en mémoire avec la clé de CA (pas de ssh-keygen -s). Le certificat
+ * est écrit à côté de la clé, par ex. ~/.ssh/id_ed25519-cert.pub.
+ * 
+ * @param key_type Type de clé à certifier
+ * @param options Clé de CA, principaux (au moins un), fenêtre de validité, numéro de série
+ * @return krown_auth_result_t KROWN_AUTH_ERROR_CERT si la CA n'est pas ED25519 ou sans principal
+ */
+krown_auth_result_t krown_sign_public_key(krown_key_type_t key_type, const krown_cert_options_t *options);
+
+/**
+ * @brief Signe un lot de clés publiques avec la même CA
+ * 
+ * La clé de CA n'est lue qu'une fois ; la clé i reçoit le numéro de série options->serial + i.
+ * Pour chaque <clé>.pub, le certificat est écrit dans <clé>-cert.pub.
+ * 
+ * @param options Paramètres d'émission
+ * @param public_key_paths Chemins des clés publiques à signer
+ * @param count Nombre de clés
+ * @return krown_auth_result_t Code de retour (s'arrête à la première erreur)
+ */
+krown_auth_result_t krown_sign_public_key_files(const krown_cert_options_t *options,
+                                                const char *const *public_key_paths, size_t count);
+
+/**
+ * @brief Horloge monotone en millisecondes, pour calculer une échéance
+ * 
+ * @return uint64_t Temps écoulé depuis une origine arbitraire
+ */
+uint64_t krown_monotonic_ms(void);
+
+/**
+ * @brief Prépare la VM en respectant une échéance
+ * 
+ * Choisit la stratégie la moins coûteuse qui tient dans le budget restant (clé existante,
+ * pool, clé dérivée, ED25519, ECDSA, RSA), d'après le coût mesuré des appels précédents.
+ * Une stratégie interrompue par l'échéance voit son coût estimé relevé (au moins le double
+ * du temps qu'elle a consommé), pour être écartée aux appels suivants avec le même budget.
+ * Non thread-safe : ces estimations sont globales au processus ; sérialiser les appels.
+ * Un ssh-keygen encore en cours à l'échéance est tué avec son groupe de processus et ses
+ * fichiers partiels supprimés.
+ * Sans options->force, un fichier de clé déjà présent n'est jamais supprimé ni écrasé :
+ * la stratégie qui l'écrirait est abandonnée au profit de la suivante.
+ * Avec un seed, la clé ED25519 en place n'est acceptée que si c'est la clé dérivée.
+ * Si options->identity est fourni, il reçoit la clé privée retenue (construite en mémoire
+ * pour une clé dérivée, lue une seule fois sinon), à libérer avec krown_identity_cleanup().
+ * OpenSSH n'est requis que si une stratégie ssh-keygen est tentée.
+ * 
+ * @param public_key_path Buffer pour le chemin de la clé publique
+ * @param path_size Taille du buffer
+ * @param options Échéance et stratégies (NULL = comme prepare_vm_for_krown(), sans échéance)
+ * @param report Compte rendu (peut être NULL)
+ * @return krown_auth_result_t KROWN_AUTH_ERROR_TIMEOUT si l'échéance est dépassée
+ */
+krown_auth_result_t prepare_vm_for_krown_ex(char *public_key_path, size_t path_size,
+                                            const krown_prepare_options_t *options,
+                                            krown_prepare_report_t *report);
+
 /**
  * @brief Libère les ressources allouées par le module
  * 
@@ -0,0 +1,191 @@
+#ifndef KROWN_INTERNAL_H
+#define KROWN_INTERNAL_H
+
+/*
+ * En-tête interne partagé entre les fichiers de src/.
+ * Ne fait pas partie de l'API publique (ne pas installer).
+ */
+
+#include "krown_auth.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define KROWN_MAX_PATH_LENGTH 512
+
+/**
+ * @brief Buffer dynamique au format wire SSH (RFC 4251)
+ */
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+} krown_buf_t;
+
+/**
+ * @brief Lecteur séquentiel sur un buffer au format wire SSH
+ */
+typedef struct {
+    const unsigned char *p;
+    size_t left;
+} krown_reader_t;
+
+int krown_buf_put(krown_buf_t *buf, const void *data, size_t len);
+int krown_buf_put_u8(krown_buf_t *buf, uint8_t value);
+int krown_buf_put_u32(krown_buf_t *buf, uint32_t value);
+int krown_buf_put_u64(krown_buf_t *buf, uint64_t value);
+int krown_buf_put_string(krown_buf_t *buf, const void *data, size_t len);
+int krown_buf_put_cstring(krown_buf_t *buf, const char *str);
+
+/**
+ * @brief Libère le buffer après avoir effacé son contenu (peut contenir une clé privée)
+ */
+void krown_buf_free(krown_buf_t *buf);
+
+int krown_read_u32(krown_reader_t *reader, uint32_t *value);
+int krown_read_string(krown_reader_t *reader, const unsigned char **data, size_t *len);
+
+/**
+ * @brief Efface une zone mémoire sans que le compilateur puisse l'optimiser
+ */
+void krown_secure_zero(void *ptr, size_t len);
+
+/**
+ * @brief Encode en base64 (sans retour à la ligne)
+ *
+ * @return longueur écrite (hors '\0'), ou -1 si le buffer est trop petit
+ */
+int krown_base64_encode(const unsigned char *data, size_t len, char *out, size_t out_size);
+
+/**
+ * @brief Décode du base64 en ignorant les blancs
+ *
+ * @return longueur décodée, ou -1 si l'entrée est invalide ou le buffer trop petit
+ */
+int krown_base64_decode(const char *in, size_t in_len, unsigned char *out, size_t out_size);
+
+/**
+ * @brief Analyse une clé privée OpenSSH (openssh-key-v1, non chiffrée)
+ *
+ * Remplit identity->key_blob (format attendu par l'agent) et identity->public_blob.
+ */
+krown_auth_result_t krown_parse_private_key(const char *pem, size_t pem_len, krown_identity_t *identity);
+
+/**
+ * @brief Lit et analyse une clé privée OpenSSH non chiffrée (clé de VM ou de CA)
+ */
+krown_auth_result_t krown_read_private_key(const char *private_key_path, krown_identity_t *identity);
+
+/* Primitives cryptographiques embarquées (krown_crypto.c) */
+
+#define KROWN_SHA256_SIZE 32
+#define KROWN_ED25519_SEED_SIZE 32
+#define KROWN_ED25519_PUBLIC_SIZE 32
+#define KROWN_ED25519_SIGNATURE_SIZE 64
+
+/**
+ * @brief Clé publique Ed25519 au format wire SSH ("ssh-ed25519", clé)
+ */
+int krown_ed25519_public_blob(const unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE], krown_buf_t *blob);
+
+/**
+ * @brief Formate une ligne de clé publique OpenSSH "<type> <base64> <commentaire>"
+ *
+ * @return longueur écrite (hors '\0'), ou -1 si le blob est invalide ou le buffer trop petit
+ */
+int krown_format_public_key_line(const unsigned char *blob, size_t blob_len, const char *comment,
+                                 char *out, size_t out_size);
+
+/**
+ * @brief Sérialise une clé privée Ed25519 au format openssh-key-v1 (non chiffrée)
+ */
+int krown_format_ed25519_private_key(const unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE],
+                                     const unsigned char seed[KROWN_ED25519_SEED_SIZE],
+                                     const char *comment, krown_buf_t *pem);
+
+void krown_hmac_sha256(const void *key, size_t key_len, const void *data, size_t len,
+                       unsigned char out[KROWN_SHA256_SIZE]);
+
+/**
+ * @brief HKDF-SHA256 (RFC 5869), étape d'extraction : PRK = HMAC(salt, IKM)
+ */
+void krown_hkdf_sha256_extract(const void *salt, size_t salt_len, const void *ikm, size_t ikm_len,
+                               unsigned char prk[KROWN_SHA256_SIZE]);
+
+/**
+ * @brief HKDF-SHA256 (RFC 5869), étape d'expansion
+ *
+ * @return 0 en cas de succès, -1 si la longueur demandée ou info est trop grande
+ */
+int krown_hkdf_sha256_expand(const unsigned char prk[KROWN_SHA256_SIZE], const void *info, size_t info_len,
+                             unsigned char *out, size_t out_len);
+
+/**
+ * @brief Calcule la clé publique Ed25519 associée à un seed de 32 octets
+ */
+void krown_ed25519_public_key(unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE],
+                              const unsigned char seed[KROWN_ED25519_SEED_SIZE]);
+
+/**
+ * @brief Signature Ed25519 (RFC 8032)
+ */
+void krown_ed25519_sign(unsigned char signature[KROWN_ED25519_SIGNATURE_SIZE],
+                        const unsigned char *message, size_t message_len,
+                        const unsigned char seed[KROWN_ED25519_SEED_SIZE],
+                        const unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE]);
+
+/**
+ * @brief Lit des octets aléatoires depuis /dev/urandom
+ */
+int krown_random_bytes(void *buffer, size_t len);
+
+#define KROWN_CERT_NONCE_SIZE 32
+
+/**
+ * @brief krown_sign_public_key_files() avec un nonce imposé (NULL = aléatoire)
+ *
+ * Réservé aux tests : avec un nonce fixe, le certificat produit est reproductible.
+ */
+krown_auth_result_t krown_sign_public_key_files_nonce(const krown_cert_options_t *options,
+                                                      const char *const *public_key_paths, size_t count,
+                                                      const unsigned char nonce[KROWN_CERT_NONCE_SIZE]);
+
+/**
+ * @brief krown_derive_ed25519_keys() qui remet aussi la clé dans identity (peut être NULL)
+ *
+ * L'identité est construite en mémoire à partir du seed, sans relire ~/.ssh/id_ed25519.
+ */
+krown_auth_result_t krown_derive_ed25519_keys_identity(const char *seed_path, const char *vm_id, bool force,
+                                                       krown_identity_t *identity);
+
+/**
+ * @brief Construit le chemin complet d'un fichier dans ~/.ssh
+ */
+int krown_build_ssh_path(const char *filename, char *buffer, size_t size);
+
+/**
+ * @brief Écrit un fichier de façon atomique (fichier temporaire puis rename) avec les permissions données
+ */
+int krown_write_file(const char *path, const void *data, size_t len, unsigned int permissions);
+
+/**
+ * @brief Description d'un type de clé : nom de fichier et arguments de ssh-keygen
+ */
+typedef struct {
+    const char *file_name;     /* id_ed25519, id_rsa, id_ecdsa */
+    const char *keygen_type;   /* Argument de -t */
+    const char *keygen_bits;   /* Argument de -b (NULL = défaut de ssh-keygen) */
+} krown_key_spec_t;
+
+const krown_key_spec_t *krown_key_spec(krown_key_type_t key_type);
+
+/**
+ * @brief Nom de fichier de base (id_ed25519, id_rsa, id_ecdsa) pour un type de clé
+ */
+const char *krown_key_file_name(krown_key_type_t key_type);
+
+/**
+ * @brief Vérifie et corrige les permissions des clés existantes (600 privée, 644 publique)
+ */
+krown_auth_result_t krown_ensure_key_permissions(krown_key_type_t key_type);
+
+#endif /* KROWN_INTERNAL_H */
@@ -0,0 +1,213 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "krown_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+// Protocole ssh-agent (draft-miller-ssh-agent)
+#define SSH_AGENT_FAILURE 5
+#define SSH_AGENT_SUCCESS 6
+#define SSH2_AGENTC_ADD_IDENTITY 17
+#define SSH2_AGENTC_ADD_ID_CONSTRAINED 25
+#define SSH_AGENT_CONSTRAIN_LIFETIME 1
+#define SSH_AGENT_CONSTRAIN_CONFIRM 2
+
+#define AGENT_MAX_REPLY_LENGTH (256 * 1024)
+#define AGENT_IO_TIMEOUT_SECONDS 5
+
+#ifndef _WIN32
+
+#ifdef MSG_NOSIGNAL
+#define AGENT_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define AGENT_SEND_FLAGS 0
+#endif
+
+/**
+ * @brief Ouvre une connexion vers l'agent désigné par $SSH_AUTH_SOCK
+ */
+static int agent_connect(void) {
+    const char *sock_path = getenv("SSH_AUTH_SOCK");
+    if (sock_path == NULL || sock_path[0] == '\0') {
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(sock_path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    strncpy(addr.sun_path, sock_path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Un agent bloqué ne doit pas bloquer la préparation de la VM
+    struct timeval tv = { AGENT_IO_TIMEOUT_SECONDS, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int agent_write_all(int fd, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, AGENT_SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int agent_read_all(int fd, unsigned char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lit une réponse de l'agent et retourne son type de message
+ */
+static int agent_read_reply(int fd) {
+    unsigned char header[4];
+    if (agent_read_all(fd, header, sizeof(header)) != 0) {
+        return -1;
+    }
+
+    uint32_t len = ((uint32_t)header[0] << 24) | ((uint32_t)header[1] << 16) |
+                   ((uint32_t)header[2] << 8) | (uint32_t)header[3];
+    if (len == 0 || len > AGENT_MAX_REPLY_LENGTH) {
+        return -1;
+    }
+
+    // Les réponses à un ajout d'identité tiennent sur un octet, mais on vide tout le message
+    unsigned char chunk[256];
+    int type = -1;
+    while (len > 0) {
+        size_t n = (len < sizeof(chunk)) ? len : sizeof(chunk);
+        if (agent_read_all(fd, chunk, n) != 0) {
+            return -1;
+        }
+        if (type < 0) {
+            type = chunk[0];
+        }
+        len -= (uint32_t)n;
+    }
+    return type;
+}
+
+/**
+ * @brief Construit une requête d'ajout d'identité (avec ou sans contraintes)
+ */
+static int build_add_request(krown_buf_t *msg, const krown_identity_t *identity,
+                             const krown_agent_constraints_t *constraints) {
+    bool constrained = constraints != NULL && (constraints->lifetime > 0 || constraints->confirm);
+
+    msg->len = 0;
+    if (krown_buf_put_u32(msg, 0) != 0 ||  // Longueur, complétée ensuite
+        krown_buf_put_u8(msg, constrained ? SSH2_AGENTC_ADD_ID_CONSTRAINED : SSH2_AGENTC_ADD_IDENTITY) != 0 ||
+        krown_buf_put(msg, identity->key_blob, identity->key_blob_len) != 0) {
+        return -1;
+    }
+
+    if (constrained) {
+        if (constraints->lifetime > 0) {
+            if (krown_buf_put_u8(msg, SSH_AGENT_CONSTRAIN_LIFETIME) != 0 ||
+                krown_buf_put_u32(msg, (uint32_t)constraints->lifetime) != 0) {
+                return -1;
+            }
+        }
+        if (constraints->confirm) {
+            if (krown_buf_put_u8(msg, SSH_AGENT_CONSTRAIN_CONFIRM) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    uint32_t body_len = (uint32_t)(msg->len - 4);
+    msg->data[0] = (unsigned char)(body_len >> 24);
+    msg->data[1] = (unsigned char)(body_len >> 16);
+    msg->data[2] = (unsigned char)(body_len >> 8);
+    msg->data[3] = (unsigned char)body_len;
+    return 0;
+}
+
+krown_auth_result_t krown_agent_add(const krown_identity_t *identities, size_t count,
+                                    const krown_agent_constraints_t *constraints) {
+    if (identities == NULL || count == 0) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (identities[i].key_blob == NULL || identities[i].key_blob_len == 0) {
+            return KROWN_AUTH_ERROR_READ_KEY;
+        }
+    }
+
+    int fd = agent_connect();
+    if (fd < 0) {
+        return KROWN_AUTH_ERROR_AGENT;
+    }
+
+    // Une seule connexion pour tout le lot ; le buffer de requête est réutilisé
+    krown_auth_result_t result = KROWN_AUTH_SUCCESS;
+    krown_buf_t msg = { NULL, 0, 0 };
+    for (size_t i = 0; i < count; i++) {
+        if (build_add_request(&msg, &identities[i], constraints) != 0) {
+            result = KROWN_AUTH_ERROR_MEMORY;
+            break;
+        }
+        if (agent_write_all(fd, msg.data, msg.len) != 0 ||
+            agent_read_reply(fd) != SSH_AGENT_SUCCESS) {
+            result = KROWN_AUTH_ERROR_AGENT;
+            break;
+        }
+    }
+
+    krown_buf_free(&msg);
+    close(fd);
+    return result;
+}
+
+#else
+
+krown_auth_result_t krown_agent_add(const krown_identity_t *identities, size_t count,
+                                    const krown_agent_constraints_t *constraints) {
+    // Pas de socket Unix pour l'agent sous Windows : utiliser ssh-add
+    (void)identities;
+    (void)count;
+    (void)constraints;
+    return KROWN_AUTH_ERROR_AGENT;
+}
+
+#endif
@@ -1,4 +1,7 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "krown_auth.h"
+#include "krown_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,13 +21,14 @@
 #define chmod _chmod
 #else
 #include <sys/wait.h>
+#include <fcntl.h>
 #include <pwd.h>
 #endif
 
 #define SSH_DIR_PERMISSIONS 0700
 #define PRIVATE_KEY_PERMISSIONS 0600
 #define PUBLIC_KEY_PERMISSIONS 0644
-#define MAX_PATH_LENGTH 512
+#define MAX_PATH_LENGTH KROWN_MAX_PATH_LENGTH
 #define MAX_KEY_LENGTH 8192
 
 /**
@@ -74,7 +78,7 @@ static int get_home_directory(char *buffer, size_t size) {
 /**
  * @brief Construit le chemin complet d'un fichier dans .ssh
  */
-static int build_ssh_path(const char *filename, char *buffer, size_t size) {
+int krown_build_ssh_path(const char *filename, char *buffer, size_t size) {
     if (filename == NULL || buffer == NULL || size == 0) {
         return -1;
     }
@@ -98,6 +102,26 @@ static int build_ssh_path(const char *filename, char *buffer, size_t size) {
     return 0;
 }
 
+/**
+ * @brief Fichier et paramètres ssh-keygen de chaque type de clé (indexé par krown_key_type_t)
+ */
+static const krown_key_spec_t KEY_SPECS[] = {
+    { "id_ed25519", "ed25519", NULL },
+    { "id_rsa", "rsa", "4096" },
+    { "id_ecdsa", "ecdsa", "256" }
+};
+
+const krown_key_spec_t *krown_key_spec(krown_key_type_t key_type) {
+    if ((unsigned int)key_type >= sizeof(KEY_SPECS) / sizeof(KEY_SPECS[0])) {
+        return &KEY_SPECS[KROWN_KEY_RSA_4096];
+    }
+    return &KEY_SPECS[key_type];
+}
+
+const char *krown_key_file_name(krown_key_type_t key_type) {
+    return krown_key_spec(key_type)->file_name;
+}
+
 /**
  * @brief Vérifie si un fichier existe
  */
@@ -122,6 +146,61 @@ static int set_file_permissions(const char *path, mode_t permissions) {
 #endif
 }
 
+int krown_write_file(const char *path, const void *data, size_t len, unsigned int permissions) {
+    char tmp_path[MAX_PATH_LENGTH];
+    int ret = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (ret < 0 || ret >= (int)sizeof(tmp_path)) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    size_t written = fwrite(data, 1, len, fp);
+    if (fclose(fp) != 0 || written != len) {
+        remove(tmp_path);
+        return -1;
+    }
+    remove(path);
+#else
+    // Créé directement avec les bonnes permissions : la clé n'est jamais lisible par d'autres
+    unlink(tmp_path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, (mode_t)permissions);
+    if (fd < 0) {
+        return -1;
+    }
+    const unsigned char *p = (const unsigned char *)data;
+    size_t left = len;
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            close(fd);
+            unlink(tmp_path);
+            return -1;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    // fchmod : le umask a pu restreindre les permissions demandées à open()
+    int chmod_ret = fchmod(fd, (mode_t)permissions);
+    if (close(fd) != 0 || chmod_ret != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+#endif
+
+    if (rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * @brief Exécute une commande système et capture sa sortie
  */
@@ -252,9 +331,9 @@ bool krown_keys_exist(krown_key_type_t key_type) {
     char private_key_path[MAX_PATH_LENGTH];
     char public_key_path[MAX_PATH_LENGTH];
     
-    const char *key_name = (key_type == KROWN_KEY_ED25519) ? "id_ed25519" : "id_rsa";
+    const char *key_name = krown_key_file_name(key_type);
     
-    if (build_ssh_path(key_name, private_key_path, sizeof(private_key_path)) != 0) {
+    if (krown_build_ssh_path(key_name, private_key_path, sizeof(private_key_path)) != 0) {
         return false;
     }
     
@@ -282,9 +361,9 @@ krown_auth_result_t krown_generate_ssh_keys(krown_key_type_t key_type, bool forc
     }
     
     char private_key_path[MAX_PATH_LENGTH];
-    const char *key_name = (key_type == KROWN_KEY_ED25519) ? "id_ed25519" : "id_rsa";
+    const char *key_name = krown_key_file_name(key_type);
     
-    if (build_ssh_path(key_name, private_key_path, sizeof(private_key_path)) != 0) {
+    if (krown_build_ssh_path(key_name, private_key_path, sizeof(private_key_path)) != 0) {
         return KROWN_AUTH_ERROR_SSH_DIR;
     }
     
@@ -296,29 +375,20 @@ krown_auth_result_t krown_generate_ssh_keys(krown_key_type_t key_type, bool forc
     // Construire la commande ssh-keygen
     char command[1024];
     int cmd_len;
+    const krown_key_spec_t *spec = krown_key_spec(key_type);
 #ifdef _WIN32
     // Sur Windows, utiliser des guillemets doubles et rediriger stderr vers nul
-    if (key_type == KROWN_KEY_ED25519) {
-        cmd_len = snprintf(command, sizeof(command), 
-                          "ssh-keygen -t ed25519 -f \"%s\" -N \"\" -q 2>nul", 
-                          private_key_path);
-    } else {
-        cmd_len = snprintf(command, sizeof(command), 
-                          "ssh-keygen -t rsa -b 4096 -f \"%s\" -N \"\" -q 2>nul", 
-                          private_key_path);
-    }
+    cmd_len = snprintf(command, sizeof(command), 
+                      "ssh-keygen -t %s%s%s -f \"%s\" -N \"\" -q 2>nul", 
+                      spec->keygen_type, spec->keygen_bits ? " -b " : "",
+                      spec->keygen_bits ? spec->keygen_bits : "", private_key_path);
 #else
     // Sur Linux/Unix, utiliser des guillemets simples pour le chemin
     // et rediriger stderr vers stdout (2>&1) puis vers /dev/null pour le mode silencieux
-    if (key_type == KROWN_KEY_ED25519) {
-        cmd_len = snprintf(command, sizeof(command), 
-                          "ssh-keygen -t ed25519 -f '%s' -N '' -q >/dev/null 2>&1", 
-                          private_key_path);
-    } else {
-        cmd_len = snprintf(command, sizeof(command), 
-                          "ssh-keygen -t rsa -b 4096 -f '%s' -N '' -q >/dev/null 2>&1", 
-                          private_key_path);
-    }
+    cmd_len = snprintf(command, sizeof(command), 
+                      "ssh-keygen -t %s%s%s -f '%s' -N '' -q >/dev/null 2>&1", 
+                      spec->keygen_type, spec->keygen_bits ? " -b " : "",
+                      spec->keygen_bits ? spec->keygen_bits : "", private_key_path);
 #endif
     
     // Vérifier que la commande n'a pas été tronquée
@@ -364,11 +434,11 @@ krown_auth_result_t krown_get_public_key_path(krown_key_type_t key_type, char *b
         return KROWN_AUTH_ERROR_MEMORY;
     }
     
-    const char *key_name = (key_type == KROWN_KEY_ED25519) ? "id_ed25519" : "id_rsa";
+    const char *key_name = krown_key_file_name(key_type);
     char filename[MAX_PATH_LENGTH];
     snprintf(filename, sizeof(filename), "%s.pub", key_name);
     
-    if (build_ssh_path(filename, buffer, buffer_size) != 0) {
+    if (krown_build_ssh_path(filename, buffer, buffer_size) != 0) {
         return KROWN_AUTH_ERROR_SSH_DIR;
     }
     
@@ -422,15 +492,62 @@ krown_auth_result_t krown_get_public_key(krown_key_type_t key_type, char *buffer
     return KROWN_AUTH_SUCCESS;
 }
 
+krown_auth_result_t krown_read_private_key(const char *private_key_path, krown_identity_t *identity) {
+    FILE *fp = fopen(private_key_path, "r");
+    if (fp == NULL) {
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+
+    char content[MAX_KEY_LENGTH + 1];
+    size_t len = fread(content, 1, MAX_KEY_LENGTH, fp);
+    fclose(fp);
+    content[len] = '\0';
+
+    krown_auth_result_t result = krown_parse_private_key(content, len, identity);
+    krown_secure_zero(content, sizeof(content));
+    return result;
+}
+
+krown_auth_result_t krown_load_identity_file(const char *private_key_path, krown_identity_t *identity) {
+    if (private_key_path == NULL || identity == NULL) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+    memset(identity, 0, sizeof(*identity));
+
+    if (strlen(private_key_path) >= MAX_PATH_LENGTH) {
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+
+    struct stat st;
+    if (stat(private_key_path, &st) != 0 || st.st_size <= 0 || st.st_size > MAX_KEY_LENGTH) {
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+
+    return krown_read_private_key(private_key_path, identity);
+}
+
+krown_auth_result_t krown_load_identity(krown_key_type_t key_type, krown_identity_t *identity) {
+    if (identity == NULL) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+
+    char private_key_path[MAX_PATH_LENGTH];
+    if (krown_build_ssh_path(krown_key_file_name(key_type), private_key_path, sizeof(private_key_path)) != 0) {
+        return KROWN_AUTH_ERROR_SSH_DIR;
+    }
+
+    return krown_load_identity_file(private_key_path, identity);
+}
+
 /**
  * @brief Vérifie et corrige les permissions des clés SSH existantes
  */
-static krown_auth_result_t ensure_key_permissions(krown_key_type_t key_type) {
+krown_auth_result_t krown_ensure_key_permissions(krown_key_type_t key_type) {
     char private_key_path[MAX_PATH_LENGTH];
     char public_key_path[MAX_PATH_LENGTH];
-    const char *key_name = (key_type == KROWN_KEY_ED25519) ? "id_ed25519" : "id_rsa";
+    const char *key_name = krown_key_file_name(key_type);
     
-    if (build_ssh_path(key_name, private_key_path, sizeof(private_key_path)) != 0) {
+    if (krown_build_ssh_path(key_name, private_key_path, sizeof(private_key_path)) != 0) {
         return KROWN_AUTH_ERROR_SSH_DIR;
     }
     
@@ -525,7 +642,7 @@ krown_auth_result_t prepare_vm_for_krown(char *public_key_path, size_t path_size
     }
     
     // 6. Vérifier et corriger les permissions des clés
-    result = ensure_key_permissions(key_type);
+    result = krown_ensure_key_permissions(key_type);
     if (result != KROWN_AUTH_SUCCESS) {
         return result;
     }
@@ -572,6 +689,16 @@ const char *krown_auth_get_error_message(krown_auth_result_t result) {
             return "Erreur lors de la lecture de la clé publique";
         case KROWN_AUTH_ERROR_MEMORY:
             return "Erreur d'allocation mémoire";
+        case KROWN_AUTH_ERROR_AGENT:
+            return "Erreur de communication avec ssh-agent ($SSH_AUTH_SOCK)";
+        case KROWN_AUTH_ERROR_CERT:
+            return "Erreur lors de la signature du certificat (clé de CA ED25519 requise)";
+        case KROWN_AUTH_ERROR_TIMEOUT:
+            return "Échéance dépassée avant la fin de la préparation";
+        case KROWN_AUTH_ERROR_KEY_MISMATCH:
+            return "La clé existante ne correspond pas à la clé dérivée du seed";
+        case KROWN_AUTH_ERROR_KEY_EXISTS:
+            return "Des fichiers de clé existants auraient été remplacés";
         default:
             return "Erreur inconnue";
     }
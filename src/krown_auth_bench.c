@@ -0,0 +1,440 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Banc de mesure de prepare_vm_for_krown() (une exécution par distribution).
+ *
+ * Scénarios :
+ *   cold     : aucune clé, génération ED25519 complète
+ *   warm     : clés déjà présentes (chemin le plus fréquent en production)
+ *   fallback : génération RSA 4096 (coût du repli quand ED25519 échoue)
+ *
+ * Les résultats sont écrits en JSON ; --summary agrège plusieurs fichiers en un tableau.
+ */
+
+#include "krown_auth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#define DEFAULT_ITERATIONS 20
+#define DEFAULT_FALLBACK_ITERATIONS 5
+#define MAX_SUMMARY_FILES 16
+#define SCENARIO_COUNT 3
+#define NAME_LENGTH 64
+#define VERSION_LENGTH 128
+#define PATH_LENGTH 512
+#define JSON_MAX_SIZE 65536
+
+/**
+ * @brief Statistiques d'un scénario (durées en ms)
+ */
+typedef struct {
+    char name[NAME_LENGTH];
+    int runs;
+    int errors;
+    double min_ms;
+    double median_ms;
+    double p95_ms;
+    double max_ms;
+    double mean_ms;
+} bench_stats_t;
+
+typedef krown_auth_result_t (*bench_step_t)(void);
+typedef void (*bench_setup_t)(void);
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [options]\n", program);
+    printf("       %s --summary FICHIER...\n\n", program);
+    printf("Options:\n");
+    printf("  --iterations N          Itérations des scénarios cold et warm (défaut : %d)\n", DEFAULT_ITERATIONS);
+    printf("  --fallback-iterations N Itérations du scénario fallback RSA (défaut : %d)\n", DEFAULT_FALLBACK_ITERATIONS);
+    printf("  --distro NOM            Nom de la distribution (défaut : ID de /etc/os-release)\n");
+    printf("  --output FICHIER        Fichier JSON de résultats (défaut : sortie standard)\n");
+    printf("  --summary FICHIER...    Agrège des fichiers JSON de résultats en un tableau\n");
+    printf("  --help                  Affiche cette aide\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief ID de la distribution depuis /etc/os-release ("unknown" sinon)
+ */
+static void detect_distro(char *buffer, size_t size) {
+    snprintf(buffer, size, "unknown");
+
+    FILE *fp = fopen("/etc/os-release", "r");
+    if (fp == NULL) {
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (strncmp(line, "ID=", 3) == 0) {
+            char *value = line + 3;
+            value[strcspn(value, "\r\n")] = '\0';
+            if (*value == '"') {
+                value++;
+                value[strcspn(value, "\"")] = '\0';
+            }
+            size_t len = strlen(value);
+            if (len >= size) {
+                len = size - 1;
+            }
+            memcpy(buffer, value, len);
+            buffer[len] = '\0';
+            break;
+        }
+    }
+    fclose(fp);
+}
+
+/**
+ * @brief Version d'OpenSSH (ssh -V écrit sur la sortie d'erreur)
+ */
+static void detect_openssh_version(char *buffer, size_t size) {
+    snprintf(buffer, size, "unknown");
+
+    FILE *fp = popen("ssh -V 2>&1", "r");
+    if (fp == NULL) {
+        return;
+    }
+    char line[VERSION_LENGTH];
+    if (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        // Les guillemets et antislashs casseraient le JSON
+        for (char *p = line; *p != '\0'; p++) {
+            if (*p == '"' || *p == '\\') {
+                *p = '\'';
+            }
+        }
+        snprintf(buffer, size, "%s", line);
+    }
+    pclose(fp);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Percentile par rang le plus proche sur un tableau trié
+ */
+static double percentile(const double *sorted, int count, int percent) {
+    int rank = (percent * count + 99) / 100;
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+static void compute_stats(bench_stats_t *stats, double *samples, int count) {
+    stats->runs = count;
+    if (count == 0) {
+        return;
+    }
+
+    qsort(samples, (size_t)count, sizeof(double), compare_double);
+    double total = 0.0;
+    for (int i = 0; i < count; i++) {
+        total += samples[i];
+    }
+    stats->min_ms = samples[0];
+    stats->median_ms = percentile(samples, count, 50);
+    stats->p95_ms = percentile(samples, count, 95);
+    stats->max_ms = samples[count - 1];
+    stats->mean_ms = total / count;
+}
+
+/**
+ * @brief Supprime le contenu de ~/.ssh (le HOME du banc est un dossier temporaire)
+ */
+static void remove_ssh_files(const char *home, bool remove_directory) {
+    char ssh_dir[PATH_LENGTH];
+    snprintf(ssh_dir, sizeof(ssh_dir), "%s/.ssh", home);
+
+    DIR *dir = opendir(ssh_dir);
+    if (dir == NULL) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char path[PATH_LENGTH + NAME_LENGTH * 4];
+        snprintf(path, sizeof(path), "%s/%s", ssh_dir, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+
+    if (remove_directory) {
+        rmdir(ssh_dir);
+    }
+}
+
+static const char *bench_home;
+
+/**
+ * @brief Préparation non chronométrée : ~/.ssh vide avant chaque mesure
+ */
+static void setup_empty_ssh(void) {
+    remove_ssh_files(bench_home, false);
+}
+
+static krown_auth_result_t step_cold(void) {
+    char path[PATH_LENGTH];
+    return prepare_vm_for_krown(path, sizeof(path));
+}
+
+static krown_auth_result_t step_warm(void) {
+    char path[PATH_LENGTH];
+    return prepare_vm_for_krown(path, sizeof(path));
+}
+
+static krown_auth_result_t step_fallback(void) {
+    char path[PATH_LENGTH];
+    krown_prepare_options_t options = { 0, KROWN_STRATEGY_RSA, NULL, NULL, NULL, false, NULL };
+    return prepare_vm_for_krown_ex(path, sizeof(path), &options, NULL);
+}
+
+static void run_scenario(bench_stats_t *stats, const char *name, bench_setup_t setup, bench_step_t step,
+                         int iterations) {
+    double *samples = malloc(sizeof(double) * (size_t)iterations);
+    int count = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    snprintf(stats->name, sizeof(stats->name), "%s", name);
+    if (samples == NULL) {
+        stats->errors = iterations;
+        return;
+    }
+
+    for (int i = 0; i < iterations; i++) {
+        // Remise à zéro hors mesure : seul prepare_vm_for_krown*() est chronométré
+        if (setup != NULL) {
+            setup();
+        }
+        double start = now_ms();
+        krown_auth_result_t result = step();
+        double elapsed = now_ms() - start;
+        if (result == KROWN_AUTH_SUCCESS) {
+            samples[count++] = elapsed;
+        } else {
+            fprintf(stderr, "%s #%d : %s\n", name, i + 1, krown_auth_get_error_message(result));
+            stats->errors++;
+        }
+    }
+
+    compute_stats(stats, samples, count);
+    free(samples);
+}
+
+static void write_json(FILE *out, const char *distro, const char *openssh, const bench_stats_t *stats, int count) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"distro\": \"%s\",\n", distro);
+    fprintf(out, "  \"openssh\": \"%s\",\n", openssh);
+    fprintf(out, "  \"scenarios\": [\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "    {\"name\": \"%s\", \"runs\": %d, \"errors\": %d, "
+                     "\"min_ms\": %.3f, \"median_ms\": %.3f, \"p95_ms\": %.3f, "
+                     "\"max_ms\": %.3f, \"mean_ms\": %.3f}%s\n",
+                stats[i].name, stats[i].runs, stats[i].errors,
+                stats[i].min_ms, stats[i].median_ms, stats[i].p95_ms,
+                stats[i].max_ms, stats[i].mean_ms, (i + 1 < count) ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+/* Lecture des fichiers produits par write_json() (pas un analyseur JSON général) */
+
+static const char *json_find_key(const char *from, const char *end, const char *key) {
+    char pattern[NAME_LENGTH];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(from, pattern);
+    if (p == NULL || (end != NULL && p >= end)) {
+        return NULL;
+    }
+    p += strlen(pattern);
+    while (*p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+static bool json_string(const char *from, const char *end, const char *key, char *out, size_t size) {
+    const char *p = json_find_key(from, end, key);
+    if (p == NULL || *p != '"') {
+        return false;
+    }
+    p++;
+    size_t len = strcspn(p, "\"");
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return true;
+}
+
+static bool json_number(const char *from, const char *end, const char *key, double *value) {
+    const char *p = json_find_key(from, end, key);
+    if (p == NULL) {
+        return false;
+    }
+    char *stop = NULL;
+    *value = strtod(p, &stop);
+    return stop != p;
+}
+
+static char *read_text_file(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+    char *text = malloc(JSON_MAX_SIZE);
+    if (text != NULL) {
+        size_t len = fread(text, 1, JSON_MAX_SIZE - 1, fp);
+        text[len] = '\0';
+    }
+    fclose(fp);
+    return text;
+}
+
+static int print_summary(char **paths, int count) {
+    int failures = 0;
+
+    printf("%-12s %-10s %5s %6s %10s %10s %10s %10s\n",
+           "distro", "scenario", "runs", "errors", "min_ms", "median_ms", "p95_ms", "max_ms");
+    printf("------------------------------------------------------------------------------\n");
+
+    for (int f = 0; f < count; f++) {
+        char *text = read_text_file(paths[f]);
+        char distro[NAME_LENGTH];
+        if (text == NULL || !json_string(text, NULL, "distro", distro, sizeof(distro))) {
+            fprintf(stderr, "Résultats illisibles: %s\n", paths[f]);
+            free(text);
+            failures++;
+            continue;
+        }
+
+        // Un objet par scénario : les clés sont cherchées avant l'accolade fermante
+        for (const char *p = strstr(text, "{\"name\""); p != NULL; p = strstr(p + 1, "{\"name\"")) {
+            const char *end = strchr(p, '}');
+            char name[NAME_LENGTH];
+            double runs = 0, errors = 0, min_ms = 0, median_ms = 0, p95_ms = 0, max_ms = 0;
+            if (end == NULL || !json_string(p, end, "name", name, sizeof(name))) {
+                break;
+            }
+            json_number(p, end, "runs", &runs);
+            json_number(p, end, "errors", &errors);
+            json_number(p, end, "min_ms", &min_ms);
+            json_number(p, end, "median_ms", &median_ms);
+            json_number(p, end, "p95_ms", &p95_ms);
+            json_number(p, end, "max_ms", &max_ms);
+            printf("%-12s %-10s %5d %6d %10.3f %10.3f %10.3f %10.3f\n",
+                   distro, name, (int)runs, (int)errors, min_ms, median_ms, p95_ms, max_ms);
+        }
+        free(text);
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
+
+static bool parse_count(const char *text, int *value) {
+    char *end = NULL;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || parsed <= 0 || parsed > 100000) {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = DEFAULT_ITERATIONS;
+    int fallback_iterations = DEFAULT_FALLBACK_ITERATIONS;
+    char distro[NAME_LENGTH];
+    char openssh[VERSION_LENGTH];
+    const char *output_path = NULL;
+
+    detect_distro(distro, sizeof(distro));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--summary") == 0) {
+            if (i + 1 >= argc || argc - i - 1 > MAX_SUMMARY_FILES) {
+                fprintf(stderr, "--summary attend entre 1 et %d fichiers\n", MAX_SUMMARY_FILES);
+                return 2;
+            }
+            return print_summary(&argv[i + 1], argc - i - 1);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            if (!parse_count(argv[++i], &iterations)) {
+                fprintf(stderr, "Nombre d'itérations invalide: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--fallback-iterations") == 0 && i + 1 < argc) {
+            if (!parse_count(argv[++i], &fallback_iterations)) {
+                fprintf(stderr, "Nombre d'itérations invalide: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--distro") == 0 && i + 1 < argc) {
+            snprintf(distro, sizeof(distro), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Option inconnue: %s\n\n", argv[i]);
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // Les scénarios suppriment les clés : HOME temporaire pour ne jamais toucher au vrai ~/.ssh
+    char home[] = "/tmp/krown-bench-XXXXXX";
+    if (mkdtemp(home) == NULL || setenv("HOME", home, 1) != 0) {
+        fprintf(stderr, "Impossible de créer le dossier temporaire du banc\n");
+        return 1;
+    }
+    bench_home = home;
+    detect_openssh_version(openssh, sizeof(openssh));
+
+    bench_stats_t stats[SCENARIO_COUNT];
+    fprintf(stderr, "Banc krown_auth sur %s : %d itérations (fallback : %d)\n",
+            distro, iterations, fallback_iterations);
+    run_scenario(&stats[0], "cold", setup_empty_ssh, step_cold, iterations);
+    run_scenario(&stats[1], "warm", NULL, step_warm, iterations);
+    run_scenario(&stats[2], "fallback", setup_empty_ssh, step_fallback, fallback_iterations);
+
+    remove_ssh_files(home, true);
+    rmdir(home);
+
+    FILE *out = stdout;
+    if (output_path != NULL) {
+        out = fopen(output_path, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Impossible d'écrire %s\n", output_path);
+            return 1;
+        }
+    }
+    write_json(out, distro, openssh, stats, SCENARIO_COUNT);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        if (stats[i].errors > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
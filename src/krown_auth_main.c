@@ -2,11 +2,104 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#define MAX_PRINCIPALS 32
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [options]\n\n", program);
+    printf("Options:\n");
+    printf("  --load-agent            Ajoute la clé à ssh-agent ($SSH_AUTH_SOCK) sans passer par ssh-add\n");
+    printf("  --agent-lifetime SEC    Durée de vie de la clé dans l'agent (implique --load-agent)\n");
+    printf("  --agent-confirm         Confirmation à chaque usage de la clé (implique --load-agent)\n");
+    printf("  --seed FICHIER          Dérive la clé ED25519 depuis un seed maître (avec --vm-id)\n");
+    printf("  --vm-id ID              Identifiant de la VM pour la dérivation\n");
+    printf("  --ca-key FICHIER        Signe la clé en certificat utilisateur avec cette CA (ED25519)\n");
+    printf("  --principals LISTE      Principaux du certificat, séparés par des virgules (requis avec --ca-key)\n");
+    printf("  --cert-validity SEC     Durée de validité du certificat (défaut : illimitée)\n");
+    printf("  --cert-serial N         Numéro de série du certificat\n");
+    printf("  --budget-ms MS          Échéance de préparation ; stratégie choisie selon le temps restant\n");
+    printf("  --key-pool DOSSIER      Pool de paires pré-générées (id_*/id_*.pub) à consommer en priorité\n");
+    printf("  --help                  Affiche cette aide\n");
+}
 
 int main(int argc, char *argv[]) {
     char public_key_path[512];
     char public_key_content[8192];
     krown_auth_result_t result;
+    bool load_agent = false;
+    krown_agent_constraints_t constraints = { 0, false };
+    const char *seed_path = NULL;
+    const char *vm_id = NULL;
+    krown_cert_options_t cert_options = { NULL, NULL, NULL, 0, 0, 0, 0 };
+    const char *principals[MAX_PRINCIPALS];
+    long cert_validity = 0;
+    long budget_ms = 0;
+    const char *pool_dir = NULL;
+    
+    // Lire les options de la ligne de commande
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--load-agent") == 0) {
+            load_agent = true;
+        } else if (strcmp(argv[i], "--agent-lifetime") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            long lifetime = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || lifetime <= 0) {
+                fprintf(stderr, "Durée de vie invalide: %s\n", argv[i]);
+                return 2;
+            }
+            constraints.lifetime = (unsigned int)lifetime;
+            load_agent = true;
+        } else if (strcmp(argv[i], "--agent-confirm") == 0) {
+            constraints.confirm = true;
+            load_agent = true;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed_path = argv[++i];
+        } else if (strcmp(argv[i], "--vm-id") == 0 && i + 1 < argc) {
+            vm_id = argv[++i];
+        } else if (strcmp(argv[i], "--ca-key") == 0 && i + 1 < argc) {
+            cert_options.ca_key_path = argv[++i];
+        } else if (strcmp(argv[i], "--principals") == 0 && i + 1 < argc) {
+            for (char *name = strtok(argv[++i], ","); name != NULL; name = strtok(NULL, ",")) {
+                if (cert_options.principal_count == MAX_PRINCIPALS) {
+                    fprintf(stderr, "Trop de principaux (max %d)\n", MAX_PRINCIPALS);
+                    return 2;
+                }
+                principals[cert_options.principal_count++] = name;
+            }
+            cert_options.principals = principals;
+        } else if (strcmp(argv[i], "--cert-validity") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            cert_validity = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || cert_validity <= 0) {
+                fprintf(stderr, "Durée de validité invalide: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--cert-serial") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            cert_options.serial = strtoull(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0') {
+                fprintf(stderr, "Numéro de série invalide: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--budget-ms") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            budget_ms = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || budget_ms <= 0) {
+                fprintf(stderr, "Budget invalide: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--key-pool") == 0 && i + 1 < argc) {
+            pool_dir = argv[++i];
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Option inconnue: %s\n\n", argv[i]);
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
     
     // Initialiser les buffers
     public_key_path[0] = '\0';
@@ -16,8 +109,37 @@ int main(int argc, char *argv[]) {
     printf("=== Krown Auth - Préparation de la VM pour Krown ===\n\n");
     fflush(stdout);
     
+    if ((seed_path == NULL) != (vm_id == NULL)) {
+        fprintf(stderr, "--seed et --vm-id doivent être utilisés ensemble\n");
+        return 2;
+    }
+    
+    // Un certificat sans principal serait valable pour n'importe quel compte
+    if (cert_options.ca_key_path != NULL && cert_options.principal_count == 0) {
+        fprintf(stderr, "--ca-key nécessite --principals\n");
+        return 2;
+    }
+    
+    // Échéance, pool, seed ou agent : la bibliothèque choisit la stratégie (existante, pool, dérivée,
+    // ssh-keygen) et, pour l'agent, remet la clé qu'elle vient de produire ou de vérifier
+    krown_prepare_report_t report;
+    krown_identity_t identity = { 0 };
+    bool use_prepare_ex = budget_ms > 0 || pool_dir != NULL || seed_path != NULL || load_agent;
+    
     // Préparer la VM et créer les clés automatiquement
-    result = prepare_vm_for_krown(public_key_path, sizeof(public_key_path));
+    if (use_prepare_ex) {
+        // Avec un seed, seule la clé dérivée convient (sans ssh-keygen) : pas de repli sur une clé aléatoire
+        krown_prepare_options_t options = {
+            0, (seed_path != NULL) ? KROWN_STRATEGY_DERIVED : KROWN_STRATEGY_ALL,
+            pool_dir, seed_path, vm_id, false, load_agent ? &identity : NULL
+        };
+        if (budget_ms > 0) {
+            options.deadline_ms = krown_monotonic_ms() + (uint64_t)budget_ms;
+        }
+        result = prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report);
+    } else {
+        result = prepare_vm_for_krown(public_key_path, sizeof(public_key_path));
+    }
     
     if (result == KROWN_AUTH_SUCCESS) {
         printf("✓ VM préparée avec succès !\n\n");
@@ -27,6 +149,8 @@ int main(int argc, char *argv[]) {
         krown_key_type_t key_type = KROWN_KEY_ED25519;
         if (strstr(public_key_path, "id_rsa") != NULL) {
             key_type = KROWN_KEY_RSA_4096;
+        } else if (strstr(public_key_path, "id_ecdsa") != NULL) {
+            key_type = KROWN_KEY_ECDSA_P256;
         }
         
         // Lire et afficher le contenu de la clé publique
@@ -39,6 +163,38 @@ int main(int argc, char *argv[]) {
             printf("   Mais la clé existe bien à: %s\n\n", public_key_path);
         }
         
+        // Signer la clé en certificat utilisateur (id_*-cert.pub à côté de la clé)
+        if (cert_options.ca_key_path != NULL) {
+            if (cert_validity > 0) {
+                // Marge d'une minute pour les horloges légèrement en retard
+                uint64_t now = (uint64_t)time(NULL);
+                cert_options.valid_after = now - 60;
+                cert_options.valid_before = now + (uint64_t)cert_validity;
+            }
+            
+            result = krown_sign_public_key(key_type, &cert_options);
+            if (result != KROWN_AUTH_SUCCESS) {
+                printf("✗ Impossible de signer le certificat\n");
+                printf("  %s\n", krown_auth_get_error_message(result));
+                krown_identity_cleanup(&identity);
+                return 1;
+            }
+            printf("✓ Certificat écrit à côté de la clé publique (-cert.pub)\n\n");
+        }
+        
+        // Ajouter à ssh-agent la clé remise par la préparation, sans relire le fichier
+        if (load_agent) {
+            result = krown_agent_add(&identity, 1, &constraints);
+            krown_identity_cleanup(&identity);
+            
+            if (result != KROWN_AUTH_SUCCESS) {
+                printf("✗ Impossible d'ajouter la clé à ssh-agent\n");
+                printf("  %s\n", krown_auth_get_error_message(result));
+                return 1;
+            }
+            printf("✓ Clé ajoutée à ssh-agent\n\n");
+        }
+        
         printf("✓ La VM est maintenant prête pour Krown !\n");
         printf("✓ Les clés SSH ont été générées et configurées correctement.\n");
         
@@ -59,6 +215,15 @@ int main(int argc, char *argv[]) {
         } else if (result == KROWN_AUTH_ERROR_KEY_GEN) {
             printf("Conseil: Vérifiez que ssh-keygen fonctionne correctement\n");
             printf("  Test: ssh-keygen --help\n");
+        } else if (result == KROWN_AUTH_ERROR_KEY_EXISTS) {
+            printf("Conseil: Les fichiers ~/.ssh/id_* illisibles ont été conservés ; supprimez-les pour les régénérer\n");
+        } else if (result == KROWN_AUTH_ERROR_KEY_MISMATCH) {
+            printf("Conseil: La clé ~/.ssh/id_ed25519 a été conservée ; supprimez-la pour la remplacer par la clé dérivée\n");
+        } else if (result == KROWN_AUTH_ERROR_TIMEOUT) {
+            printf("Étapes terminées: 0x%x, stratégies écartées faute de temps: 0x%x, en échec: 0x%x (%llu ms)\n",
+                   report.completed_phases, report.skipped_strategies, report.failed_strategies,
+                   (unsigned long long)report.elapsed_ms);
+            return 3;
         }
         
         return 1;
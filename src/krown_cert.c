@@ -0,0 +1,322 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "krown_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SSH2_CERT_TYPE_USER 1
+#define CERT_NONCE_LENGTH KROWN_CERT_NONCE_SIZE
+#define CERT_LINE_MAX_LENGTH 8192
+#define PUBLIC_KEY_PERMISSIONS 0644
+
+/**
+ * @brief Clé de la CA chargée une fois pour toute la série de signatures
+ */
+typedef struct {
+    unsigned char seed[KROWN_ED25519_SEED_SIZE];
+    unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE];
+    krown_buf_t public_blob;
+} cert_authority_t;
+
+/**
+ * @brief Extensions standard d'un certificat utilisateur (équivalent de ssh-keygen -s sans -O)
+ *
+ * Triées par ordre lexical comme l'exige le format.
+ */
+static const char *const DEFAULT_EXTENSIONS[] = {
+    "permit-X11-forwarding",
+    "permit-agent-forwarding",
+    "permit-port-forwarding",
+    "permit-pty",
+    "permit-user-rc"
+};
+
+static krown_auth_result_t cert_authority_load(cert_authority_t *ca, const char *ca_key_path) {
+    memset(ca, 0, sizeof(*ca));
+
+    krown_identity_t identity;
+    memset(&identity, 0, sizeof(identity));
+    krown_auth_result_t result = krown_read_private_key(ca_key_path, &identity);
+    if (result != KROWN_AUTH_SUCCESS) {
+        return result;
+    }
+
+    // Bloc agent ED25519 : type, clé publique (32), seed || clé publique (64), commentaire
+    krown_reader_t reader = { identity.key_blob, identity.key_blob_len };
+    const unsigned char *pk, *sk;
+    size_t pk_len, sk_len;
+    if (identity.key_type != KROWN_KEY_ED25519 ||
+        krown_read_string(&reader, NULL, NULL) != 0 ||
+        krown_read_string(&reader, &pk, &pk_len) != 0 ||
+        krown_read_string(&reader, &sk, &sk_len) != 0 ||
+        pk_len != KROWN_ED25519_PUBLIC_SIZE ||
+        sk_len != KROWN_ED25519_SEED_SIZE + KROWN_ED25519_PUBLIC_SIZE) {
+        krown_identity_cleanup(&identity);
+        return KROWN_AUTH_ERROR_CERT;
+    }
+
+    memcpy(ca->public_key, pk, KROWN_ED25519_PUBLIC_SIZE);
+    memcpy(ca->seed, sk, KROWN_ED25519_SEED_SIZE);
+    krown_identity_cleanup(&identity);
+
+    if (krown_ed25519_public_blob(ca->public_key, &ca->public_blob) != 0) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+    return KROWN_AUTH_SUCCESS;
+}
+
+static void cert_authority_cleanup(cert_authority_t *ca) {
+    krown_secure_zero(ca->seed, sizeof(ca->seed));
+    krown_buf_free(&ca->public_blob);
+}
+
+/**
+ * @brief Type de certificat correspondant au type de clé publique
+ */
+static const char *cert_type_name(const unsigned char *type, size_t type_len) {
+    if (type_len == 11 && memcmp(type, "ssh-ed25519", 11) == 0) {
+        return "ssh-ed25519-cert-v01@openssh.com";
+    }
+    if (type_len == 7 && memcmp(type, "ssh-rsa", 7) == 0) {
+        return "ssh-rsa-cert-v01@openssh.com";
+    }
+    if (type_len == 19 && memcmp(type, "ecdsa-sha2-nistp256", 19) == 0) {
+        return "ecdsa-sha2-nistp256-cert-v01@openssh.com";
+    }
+    return NULL;
+}
+
+/**
+ * @brief Lit une ligne "<type> <base64> [commentaire]" et décode la clé publique
+ */
+static krown_auth_result_t read_public_key_file(const char *path, unsigned char *blob, size_t blob_size,
+                                                size_t *blob_len, char *comment, size_t comment_size) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+
+    char line[CERT_LINE_MAX_LENGTH];
+    if (fgets(line, sizeof(line), fp) == NULL) {
+        fclose(fp);
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+    fclose(fp);
+    line[strcspn(line, "\r\n")] = '\0';
+
+    char *b64 = strchr(line, ' ');
+    if (b64 == NULL) {
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+    b64++;
+    char *end = strchr(b64, ' ');
+    size_t b64_len = (end != NULL) ? (size_t)(end - b64) : strlen(b64);
+
+    comment[0] = '\0';
+    if (end != NULL) {
+        strncpy(comment, end + 1, comment_size - 1);
+        comment[comment_size - 1] = '\0';
+    }
+
+    int len = krown_base64_decode(b64, b64_len, blob, blob_size);
+    if (len <= 0) {
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+    *blob_len = (size_t)len;
+    return KROWN_AUTH_SUCCESS;
+}
+
+/**
+ * @brief Construit et signe le certificat d'une clé publique (format PROTOCOL.certkeys)
+ */
+static krown_auth_result_t build_certificate(const cert_authority_t *ca, const krown_cert_options_t *options,
+                                             const unsigned char *key_blob, size_t key_blob_len,
+                                             const char *key_id, uint64_t serial,
+                                             const unsigned char nonce[CERT_NONCE_LENGTH],
+                                             krown_buf_t *cert, const char **cert_type) {
+    krown_reader_t reader = { key_blob, key_blob_len };
+    const unsigned char *type;
+    size_t type_len;
+    if (krown_read_string(&reader, &type, &type_len) != 0) {
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+    *cert_type = cert_type_name(type, type_len);
+    if (*cert_type == NULL) {
+        return KROWN_AUTH_ERROR_CERT;
+    }
+
+    krown_buf_t principals = { NULL, 0, 0 };
+    krown_buf_t extensions = { NULL, 0, 0 };
+    krown_auth_result_t result = KROWN_AUTH_ERROR_MEMORY;
+
+    for (size_t i = 0; i < options->principal_count; i++) {
+        if (options->principals[i] == NULL || krown_buf_put_cstring(&principals, options->principals[i]) != 0) {
+            goto out;
+        }
+    }
+    for (size_t i = 0; i < sizeof(DEFAULT_EXTENSIONS) / sizeof(DEFAULT_EXTENSIONS[0]); i++) {
+        if (krown_buf_put_cstring(&extensions, DEFAULT_EXTENSIONS[i]) != 0 ||
+            krown_buf_put_string(&extensions, NULL, 0) != 0) {
+            goto out;
+        }
+    }
+
+    uint64_t valid_before = (options->valid_before == 0) ? UINT64_MAX : options->valid_before;
+
+    // Les champs publics de la clé suivent directement le nonce, sans leur nom de type
+    cert->len = 0;
+    if (krown_buf_put_cstring(cert, *cert_type) != 0 ||
+        krown_buf_put_string(cert, nonce, CERT_NONCE_LENGTH) != 0 ||
+        krown_buf_put(cert, reader.p, reader.left) != 0 ||
+        krown_buf_put_u64(cert, serial) != 0 ||
+        krown_buf_put_u32(cert, SSH2_CERT_TYPE_USER) != 0 ||
+        krown_buf_put_cstring(cert, key_id) != 0 ||
+        krown_buf_put_string(cert, principals.data, principals.len) != 0 ||
+        krown_buf_put_u64(cert, options->valid_after) != 0 ||
+        krown_buf_put_u64(cert, valid_before) != 0 ||
+        krown_buf_put_string(cert, NULL, 0) != 0 ||                  // Options critiques
+        krown_buf_put_string(cert, extensions.data, extensions.len) != 0 ||
+        krown_buf_put_string(cert, NULL, 0) != 0 ||                  // Réservé
+        krown_buf_put_string(cert, ca->public_blob.data, ca->public_blob.len) != 0) {
+        goto out;
+    }
+
+    unsigned char signature[KROWN_ED25519_SIGNATURE_SIZE];
+    krown_ed25519_sign(signature, cert->data, cert->len, ca->seed, ca->public_key);
+
+    krown_buf_t signature_blob = { NULL, 0, 0 };
+    if (krown_buf_put_cstring(&signature_blob, "ssh-ed25519") == 0 &&
+        krown_buf_put_string(&signature_blob, signature, sizeof(signature)) == 0 &&
+        krown_buf_put_string(cert, signature_blob.data, signature_blob.len) == 0) {
+        result = KROWN_AUTH_SUCCESS;
+    }
+    krown_buf_free(&signature_blob);
+
+out:
+    krown_buf_free(&principals);
+    krown_buf_free(&extensions);
+    return result;
+}
+
+/**
+ * @brief <clé>.pub -> <clé>-cert.pub (même convention que ssh-keygen -s)
+ */
+static int cert_path_for(const char *public_key_path, char *buffer, size_t size) {
+    size_t len = strlen(public_key_path);
+    if (len > 4 && strcmp(public_key_path + len - 4, ".pub") == 0) {
+        len -= 4;
+    }
+    int ret = snprintf(buffer, size, "%.*s-cert.pub", (int)len, public_key_path);
+    return (ret < 0 || ret >= (int)size) ? -1 : 0;
+}
+
+static krown_auth_result_t sign_one(const cert_authority_t *ca, const krown_cert_options_t *options,
+                                    const char *public_key_path, uint64_t serial,
+                                    const unsigned char nonce[CERT_NONCE_LENGTH],
+                                    krown_buf_t *cert, char *line, size_t line_size) {
+    unsigned char key_blob[CERT_LINE_MAX_LENGTH];
+    size_t key_blob_len;
+    char comment[256];
+    char cert_path[KROWN_MAX_PATH_LENGTH];
+
+    if (cert_path_for(public_key_path, cert_path, sizeof(cert_path)) != 0) {
+        return KROWN_AUTH_ERROR_SSH_DIR;
+    }
+
+    krown_auth_result_t result = read_public_key_file(public_key_path, key_blob, sizeof(key_blob),
+                                                      &key_blob_len, comment, sizeof(comment));
+    if (result != KROWN_AUTH_SUCCESS) {
+        return result;
+    }
+
+    // Sans identifiant explicite, le commentaire de la clé (user@host, vm_id) sert de key ID
+    const char *key_id = options->key_id;
+    if (key_id == NULL) {
+        key_id = (comment[0] != '\0') ? comment : public_key_path;
+    }
+
+    const char *cert_type;
+    result = build_certificate(ca, options, key_blob, key_blob_len, key_id, serial, nonce, cert, &cert_type);
+    if (result != KROWN_AUTH_SUCCESS) {
+        return result;
+    }
+
+    int len = krown_format_public_key_line(cert->data, cert->len, comment, line, line_size - 1);
+    if (len < 0) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+    line[len] = '\n';
+    if (krown_write_file(cert_path, line, (size_t)len + 1, PUBLIC_KEY_PERMISSIONS) != 0) {
+        return KROWN_AUTH_ERROR_CERT;
+    }
+    return KROWN_AUTH_SUCCESS;
+}
+
+krown_auth_result_t krown_sign_public_key_files_nonce(const krown_cert_options_t *options,
+                                                      const char *const *public_key_paths, size_t count,
+                                                      const unsigned char nonce[KROWN_CERT_NONCE_SIZE]) {
+    if (options == NULL || options->ca_key_path == NULL || public_key_paths == NULL || count == 0) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+    // Sans principal, OpenSSH accepte le certificat pour n'importe quel compte
+    if (options->principal_count == 0) {
+        return KROWN_AUTH_ERROR_CERT;
+    }
+    if (options->principals == NULL) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+
+    // La CA est lue une fois ; les buffers sont réutilisés pour chaque certificat
+    cert_authority_t ca;
+    krown_auth_result_t result = cert_authority_load(&ca, options->ca_key_path);
+    if (result != KROWN_AUTH_SUCCESS) {
+        cert_authority_cleanup(&ca);
+        return result;
+    }
+
+    krown_buf_t cert = { NULL, 0, 0 };
+    char *line = malloc(CERT_LINE_MAX_LENGTH * 2);
+    unsigned char nonces[64 * CERT_NONCE_LENGTH];
+    if (line == NULL) {
+        result = KROWN_AUTH_ERROR_MEMORY;
+    }
+
+    for (size_t i = 0; i < count && result == KROWN_AUTH_SUCCESS; i++) {
+        // Aléa tiré par blocs de 64 nonces pour limiter les lectures de /dev/urandom
+        size_t slot = i % 64;
+        if (nonce != NULL) {
+            memcpy(nonces + slot * CERT_NONCE_LENGTH, nonce, CERT_NONCE_LENGTH);
+        } else if (slot == 0 && krown_random_bytes(nonces, sizeof(nonces)) != 0) {
+            result = KROWN_AUTH_ERROR_CERT;
+            break;
+        }
+        if (public_key_paths[i] == NULL) {
+            result = KROWN_AUTH_ERROR_MEMORY;
+            break;
+        }
+        result = sign_one(&ca, options, public_key_paths[i], options->serial + i,
+                          nonces + slot * CERT_NONCE_LENGTH, &cert, line, CERT_LINE_MAX_LENGTH * 2);
+    }
+
+    free(line);
+    krown_buf_free(&cert);
+    cert_authority_cleanup(&ca);
+    return result;
+}
+
+krown_auth_result_t krown_sign_public_key_files(const krown_cert_options_t *options,
+                                                const char *const *public_key_paths, size_t count) {
+    return krown_sign_public_key_files_nonce(options, public_key_paths, count, NULL);
+}
+
+krown_auth_result_t krown_sign_public_key(krown_key_type_t key_type, const krown_cert_options_t *options) {
+    char public_key_path[KROWN_MAX_PATH_LENGTH];
+    krown_auth_result_t result = krown_get_public_key_path(key_type, public_key_path, sizeof(public_key_path));
+    if (result != KROWN_AUTH_SUCCESS) {
+        return result;
+    }
+
+    const char *paths[1] = { public_key_path };
+    return krown_sign_public_key_files(options, paths, 1);
+}
@@ -0,0 +1,776 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Primitives cryptographiques embarquées : SHA-256, HMAC/HKDF-SHA256, SHA-512, Ed25519.
+ *
+ * Le module n'a pas d'autre dépendance que la libc et ssh-keygen ; ces primitives
+ * permettent de dériver et de signer des clés sans lancer de sous-processus.
+ * Ed25519 suit RFC 8032 (arithmétique en base 2^51 ou 2^16 selon le compilateur,
+ * échelle à échanges conditionnels en temps constant).
+ */
+
+#include "krown_internal.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Arithmétique du corps : 5 limbs de 51 bits si le compilateur fournit un produit
+ * 64x64 -> 128 bits (GCC/Clang 64 bits), sinon 16 limbs de 16 bits en C portable
+ * (compilateurs 32 bits, MSVC). KROWN_CRYPTO_PORTABLE force la seconde variante.
+ */
+#if defined(__SIZEOF_INT128__) && !defined(KROWN_CRYPTO_PORTABLE)
+#define KROWN_FE_51 1
+__extension__ typedef unsigned __int128 uint128_t;
+#endif
+
+/* ============================================
+ * SHA-256 (FIPS 180-4)
+ * ============================================ */
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_compress(uint32_t state[8], const unsigned char block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16) |
+               ((uint32_t)block[4 * i + 2] << 8) | (uint32_t)block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t total;
+    unsigned char block[64];
+    size_t used;
+} sha256_ctx_t;
+
+static void sha256_init(sha256_ctx_t *ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->total = 0;
+    ctx->used = 0;
+}
+
+static void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    ctx->total += len;
+    while (len > 0) {
+        size_t n = 64 - ctx->used;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ctx->block + ctx->used, p, n);
+        ctx->used += n;
+        p += n;
+        len -= n;
+        if (ctx->used == 64) {
+            sha256_compress(ctx->state, ctx->block);
+            ctx->used = 0;
+        }
+    }
+}
+
+static void sha256_final(sha256_ctx_t *ctx, unsigned char out[KROWN_SHA256_SIZE]) {
+    uint64_t bits = ctx->total * 8;
+    unsigned char pad = 0x80;
+    sha256_update(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->used != 56) {
+        sha256_update(ctx, &pad, 1);
+    }
+    unsigned char length[8];
+    for (int i = 0; i < 8; i++) {
+        length[i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    sha256_update(ctx, length, sizeof(length));
+
+    for (int i = 0; i < 8; i++) {
+        out[4 * i] = (unsigned char)(ctx->state[i] >> 24);
+        out[4 * i + 1] = (unsigned char)(ctx->state[i] >> 16);
+        out[4 * i + 2] = (unsigned char)(ctx->state[i] >> 8);
+        out[4 * i + 3] = (unsigned char)ctx->state[i];
+    }
+    krown_secure_zero(ctx, sizeof(*ctx));
+}
+
+void krown_hmac_sha256(const void *key, size_t key_len, const void *data, size_t len,
+                       unsigned char out[KROWN_SHA256_SIZE]) {
+    unsigned char block[64];
+    unsigned char inner[KROWN_SHA256_SIZE];
+    sha256_ctx_t ctx;
+
+    memset(block, 0, sizeof(block));
+    if (key_len > sizeof(block)) {
+        sha256_init(&ctx);
+        sha256_update(&ctx, key, key_len);
+        sha256_final(&ctx, block);
+    } else if (key_len > 0) {
+        memcpy(block, key, key_len);
+    }
+
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] ^= 0x36;
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, block, sizeof(block));
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, inner);
+
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] ^= 0x36 ^ 0x5c;
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, block, sizeof(block));
+    sha256_update(&ctx, inner, sizeof(inner));
+    sha256_final(&ctx, out);
+
+    krown_secure_zero(block, sizeof(block));
+    krown_secure_zero(inner, sizeof(inner));
+}
+
+void krown_hkdf_sha256_extract(const void *salt, size_t salt_len, const void *ikm, size_t ikm_len,
+                               unsigned char prk[KROWN_SHA256_SIZE]) {
+    krown_hmac_sha256(salt, salt_len, ikm, ikm_len, prk);
+}
+
+int krown_hkdf_sha256_expand(const unsigned char prk[KROWN_SHA256_SIZE], const void *info, size_t info_len,
+                             unsigned char *out, size_t out_len) {
+    if (out_len > 255 * KROWN_SHA256_SIZE || info_len > 1024) {
+        return -1;
+    }
+
+    // T(i) = HMAC(PRK, T(i-1) || info || i)
+    unsigned char input[KROWN_SHA256_SIZE + 1024 + 1];
+    unsigned char t[KROWN_SHA256_SIZE];
+    size_t t_len = 0;
+    size_t done = 0;
+    for (unsigned char counter = 1; done < out_len; counter++) {
+        size_t n = 0;
+        memcpy(input, t, t_len);
+        n += t_len;
+        if (info_len > 0) {
+            memcpy(input + n, info, info_len);
+            n += info_len;
+        }
+        input[n++] = counter;
+        krown_hmac_sha256(prk, KROWN_SHA256_SIZE, input, n, t);
+        t_len = sizeof(t);
+
+        size_t chunk = (out_len - done < sizeof(t)) ? out_len - done : sizeof(t);
+        memcpy(out + done, t, chunk);
+        done += chunk;
+    }
+
+    krown_secure_zero(input, sizeof(input));
+    krown_secure_zero(t, sizeof(t));
+    return 0;
+}
+
+/* ============================================
+ * SHA-512 (FIPS 180-4)
+ * ============================================ */
+
+static const uint64_t SHA512_K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+#define ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+static void sha512_compress(uint64_t state[8], const unsigned char block[128]) {
+    uint64_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = 0;
+        for (int j = 0; j < 8; j++) {
+            w[i] = (w[i] << 8) | block[8 * i + j];
+        }
+    }
+    for (int i = 16; i < 80; i++) {
+        uint64_t s0 = ROTR64(w[i - 15], 1) ^ ROTR64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+        uint64_t s1 = ROTR64(w[i - 2], 19) ^ ROTR64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 80; i++) {
+        uint64_t t1 = h + (ROTR64(e, 14) ^ ROTR64(e, 18) ^ ROTR64(e, 41)) + ((e & f) ^ (~e & g)) + SHA512_K[i] + w[i];
+        uint64_t t2 = (ROTR64(a, 28) ^ ROTR64(a, 34) ^ ROTR64(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+typedef struct {
+    uint64_t state[8];
+    uint64_t total;
+    unsigned char block[128];
+    size_t used;
+} sha512_ctx_t;
+
+static void sha512_init(sha512_ctx_t *ctx) {
+    static const uint64_t iv[8] = {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+    };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->total = 0;
+    ctx->used = 0;
+}
+
+static void sha512_update(sha512_ctx_t *ctx, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    ctx->total += len;
+    while (len > 0) {
+        size_t n = 128 - ctx->used;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ctx->block + ctx->used, p, n);
+        ctx->used += n;
+        p += n;
+        len -= n;
+        if (ctx->used == 128) {
+            sha512_compress(ctx->state, ctx->block);
+            ctx->used = 0;
+        }
+    }
+}
+
+static void sha512_final(sha512_ctx_t *ctx, unsigned char out[64]) {
+    uint64_t bits = ctx->total * 8;
+    unsigned char pad = 0x80;
+    sha512_update(ctx, &pad, 1);
+    pad = 0;
+    // Longueur sur 128 bits ; les messages traités ici tiennent sur 64 bits
+    while (ctx->used != 120) {
+        sha512_update(ctx, &pad, 1);
+    }
+    unsigned char length[8];
+    for (int i = 0; i < 8; i++) {
+        length[i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    sha512_update(ctx, length, sizeof(length));
+
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            out[8 * i + j] = (unsigned char)(ctx->state[i] >> (56 - 8 * j));
+        }
+    }
+    krown_secure_zero(ctx, sizeof(*ctx));
+}
+
+/* ============================================
+ * Corps GF(2^255 - 19)
+ * ============================================ */
+
+#ifdef KROWN_FE_51
+
+/* 5 limbs de 51 bits */
+
+#define FE_LIMBS 5
+typedef uint64_t fe[FE_LIMBS];
+
+#define MASK51 ((1ULL << 51) - 1)
+
+static const fe FE_D2 = {
+    0x69b9426b2f159ULL, 0x35050762add7aULL, 0x3cf44c0038052ULL, 0x6738cc7407977ULL, 0x2406d9dc56dffULL
+};
+static const fe FE_BASE_X = {
+    0x62d608f25d51aULL, 0x412a4b4f6592aULL, 0x75b7171a4b31dULL, 0x1ff60527118feULL, 0x216936d3cd6e5ULL
+};
+static const fe FE_BASE_Y = {
+    0x6666666666658ULL, 0x4ccccccccccccULL, 0x1999999999999ULL, 0x3333333333333ULL, 0x6666666666666ULL
+};
+static const fe FE_BASE_T = {
+    0x68ab3a5b7dda3ULL, 0x00eea2a5eadbbULL, 0x2af8df483c27eULL, 0x332b375274732ULL, 0x67875f0fd78b7ULL
+};
+
+static void fe_carry(fe h) {
+    uint64_t c;
+    c = h[0] >> 51; h[0] &= MASK51; h[1] += c;
+    c = h[1] >> 51; h[1] &= MASK51; h[2] += c;
+    c = h[2] >> 51; h[2] &= MASK51; h[3] += c;
+    c = h[3] >> 51; h[3] &= MASK51; h[4] += c;
+    c = h[4] >> 51; h[4] &= MASK51; h[0] += c * 19;
+    c = h[0] >> 51; h[0] &= MASK51; h[1] += c;
+}
+
+static void fe_add(fe h, const fe f, const fe g) {
+    for (int i = 0; i < 5; i++) {
+        h[i] = f[i] + g[i];
+    }
+    fe_carry(h);
+}
+
+static void fe_sub(fe h, const fe f, const fe g) {
+    // f + 4p - g : les entrées sont réduites (< 2^52), aucune limb ne devient négative
+    h[0] = f[0] + 0x1fffffffffffb4ULL - g[0];
+    h[1] = f[1] + 0x1ffffffffffffcULL - g[1];
+    h[2] = f[2] + 0x1ffffffffffffcULL - g[2];
+    h[3] = f[3] + 0x1ffffffffffffcULL - g[3];
+    h[4] = f[4] + 0x1ffffffffffffcULL - g[4];
+    fe_carry(h);
+}
+
+static void fe_mul(fe h, const fe f, const fe g) {
+    uint64_t g1_19 = 19 * g[1], g2_19 = 19 * g[2], g3_19 = 19 * g[3], g4_19 = 19 * g[4];
+
+    uint128_t r0 = (uint128_t)f[0] * g[0] + (uint128_t)f[1] * g4_19 + (uint128_t)f[2] * g3_19 +
+                   (uint128_t)f[3] * g2_19 + (uint128_t)f[4] * g1_19;
+    uint128_t r1 = (uint128_t)f[0] * g[1] + (uint128_t)f[1] * g[0] + (uint128_t)f[2] * g4_19 +
+                   (uint128_t)f[3] * g3_19 + (uint128_t)f[4] * g2_19;
+    uint128_t r2 = (uint128_t)f[0] * g[2] + (uint128_t)f[1] * g[1] + (uint128_t)f[2] * g[0] +
+                   (uint128_t)f[3] * g4_19 + (uint128_t)f[4] * g3_19;
+    uint128_t r3 = (uint128_t)f[0] * g[3] + (uint128_t)f[1] * g[2] + (uint128_t)f[2] * g[1] +
+                   (uint128_t)f[3] * g[0] + (uint128_t)f[4] * g4_19;
+    uint128_t r4 = (uint128_t)f[0] * g[4] + (uint128_t)f[1] * g[3] + (uint128_t)f[2] * g[2] +
+                   (uint128_t)f[3] * g[1] + (uint128_t)f[4] * g[0];
+
+    r1 += (uint64_t)(r0 >> 51);
+    r2 += (uint64_t)(r1 >> 51);
+    r3 += (uint64_t)(r2 >> 51);
+    r4 += (uint64_t)(r3 >> 51);
+    uint64_t c = (uint64_t)(r4 >> 51);
+
+    h[0] = ((uint64_t)r0 & MASK51) + c * 19;
+    h[1] = (uint64_t)r1 & MASK51;
+    h[2] = (uint64_t)r2 & MASK51;
+    h[3] = (uint64_t)r3 & MASK51;
+    h[4] = (uint64_t)r4 & MASK51;
+    h[1] += h[0] >> 51;
+    h[0] &= MASK51;
+}
+
+static void fe_tobytes(unsigned char out[32], const fe f) {
+    fe t;
+    memcpy(t, f, sizeof(fe));
+    fe_carry(t);
+    fe_carry(t);
+
+    // Réduction finale : soustraire p si t >= p
+    uint64_t q = (t[0] + 19) >> 51;
+    q = (t[1] + q) >> 51;
+    q = (t[2] + q) >> 51;
+    q = (t[3] + q) >> 51;
+    q = (t[4] + q) >> 51;
+
+    t[0] += 19 * q;
+    t[1] += t[0] >> 51; t[0] &= MASK51;
+    t[2] += t[1] >> 51; t[1] &= MASK51;
+    t[3] += t[2] >> 51; t[2] &= MASK51;
+    t[4] += t[3] >> 51; t[3] &= MASK51;
+    t[4] &= MASK51;
+
+    uint64_t words[4] = {
+        t[0] | (t[1] << 51),
+        (t[1] >> 13) | (t[2] << 38),
+        (t[2] >> 26) | (t[3] << 25),
+        (t[3] >> 39) | (t[4] << 12)
+    };
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 8; j++) {
+            out[8 * i + j] = (unsigned char)(words[i] >> (8 * j));
+        }
+    }
+}
+
+#else
+
+/* 16 limbs de 16 bits (sans entier 128 bits) ; 2^256 = 38 mod p */
+
+#define FE_LIMBS 16
+typedef uint64_t fe[FE_LIMBS];
+
+#define MASK16 0xffffULL
+
+static const fe FE_D2 = {
+    0xf159, 0x26b2, 0x9b94, 0xebd6, 0xb156, 0x8283, 0x149a, 0x00e0,
+    0xd130, 0xeef3, 0x80f2, 0x198e, 0xfce7, 0x56df, 0xd9dc, 0x2406
+};
+static const fe FE_BASE_X = {
+    0xd51a, 0x8f25, 0x2d60, 0xc956, 0xa7b2, 0x9525, 0xc760, 0x692c,
+    0xdc5c, 0xfdd6, 0xe231, 0xc0a4, 0x53fe, 0xcd6e, 0x36d3, 0x2169
+};
+static const fe FE_BASE_Y = {
+    0x6658, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666,
+    0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666
+};
+static const fe FE_BASE_T = {
+    0xdda3, 0xa5b7, 0x8ab3, 0x6dde, 0x52f5, 0x7751, 0x9f80, 0x20f0,
+    0xe37d, 0x64ab, 0x4e8e, 0x66ea, 0x7665, 0xd78b, 0x5f0f, 0x6787
+};
+
+/* 4p limb par limb : chaque limb dépasse 2^17, fe_sub reste positive */
+static const fe FE_4P = {
+    0x3ffb4, 0x3fffc, 0x3fffc, 0x3fffc, 0x3fffc, 0x3fffc, 0x3fffc, 0x3fffc,
+    0x3fffc, 0x3fffc, 0x3fffc, 0x3fffc, 0x3fffc, 0x3fffc, 0x3fffc, 0x1fffc
+};
+
+static void fe_carry(fe h) {
+    // Limbs < 2^16 en sortie, sauf h[1] qui peut recevoir une dernière retenue (< 2^17)
+    uint64_t c;
+    for (int i = 0; i < 15; i++) {
+        c = h[i] >> 16; h[i] &= MASK16; h[i + 1] += c;
+    }
+    c = h[15] >> 16; h[15] &= MASK16; h[0] += 38 * c;
+    c = h[0] >> 16; h[0] &= MASK16; h[1] += c;
+}
+
+static void fe_add(fe h, const fe f, const fe g) {
+    for (int i = 0; i < FE_LIMBS; i++) {
+        h[i] = f[i] + g[i];
+    }
+    fe_carry(h);
+}
+
+static void fe_sub(fe h, const fe f, const fe g) {
+    for (int i = 0; i < FE_LIMBS; i++) {
+        h[i] = f[i] + FE_4P[i] - g[i];
+    }
+    fe_carry(h);
+}
+
+static void fe_mul(fe h, const fe f, const fe g) {
+    // Entrées < 2^18 : chaque somme de produits reste sous 2^41, le repliement sous 2^47
+    uint64_t t[31] = { 0 };
+    for (int i = 0; i < FE_LIMBS; i++) {
+        for (int j = 0; j < FE_LIMBS; j++) {
+            t[i + j] += f[i] * g[j];
+        }
+    }
+    for (int i = 0; i < 15; i++) {
+        t[i] += 38 * t[i + 16];
+    }
+    for (int i = 0; i < FE_LIMBS; i++) {
+        h[i] = t[i];
+    }
+    fe_carry(h);
+    fe_carry(h);
+}
+
+static void fe_tobytes(unsigned char out[32], const fe f) {
+    fe t, m;
+    memcpy(t, f, sizeof(fe));
+    fe_carry(t);
+    fe_carry(t);
+    fe_carry(t);
+
+    // t < 2^256 < 3p : deux soustractions conditionnelles de p, sans branchement
+    for (int pass = 0; pass < 2; pass++) {
+        m[0] = t[0] - 0xffed;
+        for (int i = 1; i < 15; i++) {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= MASK16;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        m[14] &= MASK16;
+        uint64_t keep = ((m[15] >> 16) & 1) - 1;  // tous les bits à 1 si pas d'emprunt (t >= p)
+        m[15] &= MASK16;
+        for (int i = 0; i < FE_LIMBS; i++) {
+            t[i] ^= keep & (t[i] ^ m[i]);
+        }
+    }
+
+    for (int i = 0; i < FE_LIMBS; i++) {
+        out[2 * i] = (unsigned char)t[i];
+        out[2 * i + 1] = (unsigned char)(t[i] >> 8);
+    }
+}
+
+#endif /* KROWN_FE_51 */
+
+static void fe_copy(fe h, const fe f) {
+    memcpy(h, f, sizeof(fe));
+}
+
+static void fe_set(fe h, uint64_t value) {
+    memset(h, 0, sizeof(fe));
+    h[0] = value;
+}
+
+static void fe_invert(fe out, const fe z) {
+    // z^(p-2) : tous les bits de p-2 = 2^255 - 21 valent 1 sauf les bits 2 et 4
+    fe c;
+    fe_copy(c, z);
+    for (int i = 253; i >= 0; i--) {
+        fe_mul(c, c, c);
+        if (i != 2 && i != 4) {
+            fe_mul(c, c, z);
+        }
+    }
+    fe_copy(out, c);
+}
+
+static void fe_cswap(fe f, fe g, uint64_t bit) {
+    uint64_t mask = (uint64_t)0 - bit;
+    for (int i = 0; i < FE_LIMBS; i++) {
+        uint64_t x = mask & (f[i] ^ g[i]);
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+/* ============================================
+ * Courbe Edwards25519, coordonnées étendues (X:Y:Z:T)
+ * ============================================ */
+
+typedef struct {
+    fe X, Y, Z, T;
+} ge_point;
+
+static void ge_add(ge_point *r, const ge_point *p, const ge_point *q) {
+    // add-2008-hwcd-3 : formule unifiée, valable aussi pour le doublement
+    fe a, b, c, d, t, e, f, g, h;
+
+    fe_sub(a, p->Y, p->X);
+    fe_sub(t, q->Y, q->X);
+    fe_mul(a, a, t);
+    fe_add(b, p->X, p->Y);
+    fe_add(t, q->X, q->Y);
+    fe_mul(b, b, t);
+    fe_mul(c, p->T, q->T);
+    fe_mul(c, c, FE_D2);
+    fe_mul(d, p->Z, q->Z);
+    fe_add(d, d, d);
+    fe_sub(e, b, a);
+    fe_sub(f, d, c);
+    fe_add(g, d, c);
+    fe_add(h, b, a);
+
+    fe_mul(r->X, e, f);
+    fe_mul(r->Y, h, g);
+    fe_mul(r->Z, g, f);
+    fe_mul(r->T, e, h);
+}
+
+static void ge_cswap(ge_point *p, ge_point *q, uint64_t bit) {
+    fe_cswap(p->X, q->X, bit);
+    fe_cswap(p->Y, q->Y, bit);
+    fe_cswap(p->Z, q->Z, bit);
+    fe_cswap(p->T, q->T, bit);
+}
+
+/**
+ * @brief r = s * B (B point de base), en temps constant
+ */
+static void ge_scalarmult_base(ge_point *r, const unsigned char s[32]) {
+    ge_point q;
+    fe_set(r->X, 0);
+    fe_set(r->Y, 1);
+    fe_set(r->Z, 1);
+    fe_set(r->T, 0);
+    fe_copy(q.X, FE_BASE_X);
+    fe_copy(q.Y, FE_BASE_Y);
+    fe_set(q.Z, 1);
+    fe_copy(q.T, FE_BASE_T);
+
+    for (int i = 255; i >= 0; i--) {
+        uint64_t bit = (s[i / 8] >> (i & 7)) & 1;
+        ge_cswap(r, &q, bit);
+        ge_add(&q, &q, r);
+        ge_add(r, r, r);
+        ge_cswap(r, &q, bit);
+    }
+}
+
+static void ge_pack(unsigned char out[32], const ge_point *p) {
+    fe zi, x, y;
+    unsigned char xb[32];
+    fe_invert(zi, p->Z);
+    fe_mul(x, p->X, zi);
+    fe_mul(y, p->Y, zi);
+    fe_tobytes(out, y);
+    fe_tobytes(xb, x);
+    out[31] ^= (unsigned char)((xb[0] & 1) << 7);
+}
+
+/* ============================================
+ * Scalaires modulo L = 2^252 + 27742317777372353535851937790883648493
+ * ============================================ */
+
+static const int64_t SC_L[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10
+};
+
+static void sc_mod_l(unsigned char r[32], int64_t x[64]) {
+    int64_t carry;
+    int i, j;
+    for (i = 63; i >= 32; --i) {
+        carry = 0;
+        for (j = i - 32; j < i - 12; ++j) {
+            x[j] += carry - 16 * x[i] * SC_L[j - (i - 32)];
+            carry = (x[j] + 128) >> 8;
+            x[j] -= carry * 256;
+        }
+        x[j] += carry;
+        x[i] = 0;
+    }
+    carry = 0;
+    for (j = 0; j < 32; j++) {
+        x[j] += carry - (x[31] >> 4) * SC_L[j];
+        carry = x[j] >> 8;
+        x[j] &= 255;
+    }
+    for (j = 0; j < 32; j++) {
+        x[j] -= carry * SC_L[j];
+    }
+    for (i = 0; i < 32; i++) {
+        x[i + 1] += x[i] >> 8;
+        r[i] = (unsigned char)(x[i] & 255);
+    }
+}
+
+static void sc_reduce(unsigned char r[64]) {
+    int64_t x[64];
+    for (int i = 0; i < 64; i++) {
+        x[i] = r[i];
+        r[i] = 0;
+    }
+    sc_mod_l(r, x);
+}
+
+/* ============================================
+ * Ed25519 (RFC 8032)
+ * ============================================ */
+
+static void ed25519_expand_seed(unsigned char az[64], const unsigned char seed[KROWN_ED25519_SEED_SIZE]) {
+    sha512_ctx_t ctx;
+    sha512_init(&ctx);
+    sha512_update(&ctx, seed, KROWN_ED25519_SEED_SIZE);
+    sha512_final(&ctx, az);
+    az[0] &= 248;
+    az[31] &= 127;
+    az[31] |= 64;
+}
+
+void krown_ed25519_public_key(unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE],
+                              const unsigned char seed[KROWN_ED25519_SEED_SIZE]) {
+    unsigned char az[64];
+    ge_point a;
+    ed25519_expand_seed(az, seed);
+    ge_scalarmult_base(&a, az);
+    ge_pack(public_key, &a);
+    krown_secure_zero(az, sizeof(az));
+}
+
+void krown_ed25519_sign(unsigned char signature[KROWN_ED25519_SIGNATURE_SIZE],
+                        const unsigned char *message, size_t message_len,
+                        const unsigned char seed[KROWN_ED25519_SEED_SIZE],
+                        const unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE]) {
+    unsigned char az[64], nonce[64], hram[64];
+    sha512_ctx_t ctx;
+    ge_point r;
+
+    ed25519_expand_seed(az, seed);
+
+    // r = H(prefixe || M) mod L ; R = r * B
+    sha512_init(&ctx);
+    sha512_update(&ctx, az + 32, 32);
+    sha512_update(&ctx, message, message_len);
+    sha512_final(&ctx, nonce);
+    sc_reduce(nonce);
+    ge_scalarmult_base(&r, nonce);
+    ge_pack(signature, &r);
+
+    // k = H(R || A || M) mod L ; S = r + k * a mod L
+    sha512_init(&ctx);
+    sha512_update(&ctx, signature, 32);
+    sha512_update(&ctx, public_key, KROWN_ED25519_PUBLIC_SIZE);
+    sha512_update(&ctx, message, message_len);
+    sha512_final(&ctx, hram);
+    sc_reduce(hram);
+
+    int64_t x[64];
+    for (int i = 0; i < 64; i++) {
+        x[i] = (i < 32) ? nonce[i] : 0;
+    }
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            x[i + j] += (int64_t)hram[i] * az[j];
+        }
+    }
+    sc_mod_l(signature + 32, x);
+
+    krown_secure_zero(az, sizeof(az));
+    krown_secure_zero(nonce, sizeof(nonce));
+    krown_secure_zero(x, sizeof(x));
+}
+
+/* ============================================
+ * Aléa système
+ * ============================================ */
+
+int krown_random_bytes(void *buffer, size_t len) {
+    FILE *fp = fopen("/dev/urandom", "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+    size_t n = fread(buffer, 1, len, fp);
+    fclose(fp);
+    return (n == len) ? 0 : -1;
+}
@@ -0,0 +1,331 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "krown_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define SEED_MIN_LENGTH 32
+#define SEED_MAX_LENGTH 4096
+#define VM_ID_MAX_LENGTH 255
+#define PRIVATE_KEY_PERMISSIONS 0600
+#define PUBLIC_KEY_PERMISSIONS 0644
+
+// Sel HKDF versionné : changer d'algorithme de dérivation imposera un nouveau sel
+static const char DERIVE_SALT[] = "krown-auth/ed25519/v1";
+
+/**
+ * @brief Clé pseudo-aléatoire HKDF extraite du seed maître (le seed n'est pas conservé)
+ */
+typedef struct {
+    unsigned char prk[KROWN_SHA256_SIZE];
+} derive_context_t;
+
+/**
+ * @brief Lit le seed maître et prépare l'étape d'expansion HKDF
+ */
+static krown_auth_result_t derive_context_init(derive_context_t *ctx, const char *seed_path) {
+    if (seed_path == NULL) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+
+#ifdef _WIN32
+    FILE *fp = fopen(seed_path, "rb");
+    if (fp == NULL) {
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+#else
+    // O_NONBLOCK : un FIFO ne bloque pas l'ouverture, il est refusé juste après
+    int fd = open(seed_path, O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+
+    // Contrôles sur le fichier ouvert (fstat), pas sur le chemin : il ne peut plus être remplacé entre-temps
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+    // Le seed permet de recalculer toutes les clés : il ne doit être lisible que par son propriétaire
+    if (st.st_uid != geteuid() || (st.st_mode & 077) != 0) {
+        close(fd);
+        return KROWN_AUTH_ERROR_PERMISSIONS;
+    }
+
+    FILE *fp = fdopen(fd, "rb");
+    if (fp == NULL) {
+        close(fd);
+        return KROWN_AUTH_ERROR_READ_KEY;
+    }
+#endif
+
+    unsigned char seed[SEED_MAX_LENGTH + 1];
+    size_t len = fread(seed, 1, sizeof(seed), fp);
+    fclose(fp);
+
+    krown_auth_result_t result = KROWN_AUTH_SUCCESS;
+    if (len < SEED_MIN_LENGTH || len > SEED_MAX_LENGTH) {
+        result = KROWN_AUTH_ERROR_READ_KEY;
+    } else {
+        krown_hkdf_sha256_extract(DERIVE_SALT, sizeof(DERIVE_SALT) - 1, seed, len, ctx->prk);
+    }
+
+    krown_secure_zero(seed, sizeof(seed));
+    return result;
+}
+
+static void derive_context_cleanup(derive_context_t *ctx) {
+    krown_secure_zero(ctx->prk, sizeof(ctx->prk));
+}
+
+static bool valid_vm_id(const char *vm_id) {
+    if (vm_id == NULL || vm_id[0] == '\0' || strlen(vm_id) > VM_ID_MAX_LENGTH) {
+        return false;
+    }
+    // L'identifiant sert de commentaire dans les fichiers de clé : une seule ligne
+    for (const char *p = vm_id; *p != '\0'; p++) {
+        if (*p == '\n' || *p == '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief seed Ed25519 = HKDF-Expand(PRK, vm_id) ; clé publique associée
+ */
+static krown_auth_result_t derive_keypair(const derive_context_t *ctx, const char *vm_id,
+                                          unsigned char seed[KROWN_ED25519_SEED_SIZE],
+                                          unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE]) {
+    if (!valid_vm_id(vm_id)) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+    if (krown_hkdf_sha256_expand(ctx->prk, vm_id, strlen(vm_id), seed, KROWN_ED25519_SEED_SIZE) != 0) {
+        return KROWN_AUTH_ERROR_KEY_GEN;
+    }
+    krown_ed25519_public_key(public_key, seed);
+    return KROWN_AUTH_SUCCESS;
+}
+
+static krown_auth_result_t format_public_key(const unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE],
+                                             const char *vm_id, char *buffer, size_t buffer_size) {
+    krown_buf_t blob = { NULL, 0, 0 };
+    krown_auth_result_t result = KROWN_AUTH_SUCCESS;
+
+    if (krown_ed25519_public_blob(public_key, &blob) != 0) {
+        result = KROWN_AUTH_ERROR_MEMORY;
+    } else if (krown_format_public_key_line(blob.data, blob.len, vm_id, buffer, buffer_size) < 0) {
+        result = KROWN_AUTH_ERROR_MEMORY;
+    }
+
+    krown_buf_free(&blob);
+    return result;
+}
+
+krown_auth_result_t krown_derive_public_key(const char *seed_path, const char *vm_id,
+                                            char *buffer, size_t buffer_size) {
+    return krown_derive_public_keys(seed_path, &vm_id, 1, &buffer, buffer_size);
+}
+
+krown_auth_result_t krown_derive_public_keys(const char *seed_path, const char *const *vm_ids, size_t count,
+                                             char **buffers, size_t buffer_size) {
+    if (vm_ids == NULL || buffers == NULL || count == 0 || buffer_size == 0) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+
+    // Le seed est lu et l'extraction HKDF faite une seule fois pour tout le lot
+    derive_context_t ctx;
+    krown_auth_result_t result = derive_context_init(&ctx, seed_path);
+    if (result != KROWN_AUTH_SUCCESS) {
+        return result;
+    }
+
+    unsigned char seed[KROWN_ED25519_SEED_SIZE];
+    unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE];
+    for (size_t i = 0; i < count && result == KROWN_AUTH_SUCCESS; i++) {
+        if (buffers[i] == NULL) {
+            result = KROWN_AUTH_ERROR_MEMORY;
+            break;
+        }
+        result = derive_keypair(&ctx, vm_ids[i], seed, public_key);
+        if (result == KROWN_AUTH_SUCCESS) {
+            result = format_public_key(public_key, vm_ids[i], buffers[i], buffer_size);
+        }
+    }
+
+    krown_secure_zero(seed, sizeof(seed));
+    derive_context_cleanup(&ctx);
+    return result;
+}
+
+/**
+ * @brief Lit le seed maître et dérive la paire de clés de la VM
+ */
+static krown_auth_result_t derive_vm_keypair(const char *seed_path, const char *vm_id,
+                                             unsigned char seed[KROWN_ED25519_SEED_SIZE],
+                                             unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE]) {
+    derive_context_t ctx;
+    krown_auth_result_t result = derive_context_init(&ctx, seed_path);
+    if (result != KROWN_AUTH_SUCCESS) {
+        return result;
+    }
+    result = derive_keypair(&ctx, vm_id, seed, public_key);
+    derive_context_cleanup(&ctx);
+    return result;
+}
+
+static bool path_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static int build_public_key_path(const char *private_key_path, char *public_key_path) {
+    int ret = snprintf(public_key_path, KROWN_MAX_PATH_LENGTH, "%s.pub", private_key_path);
+    return (ret < 0 || ret >= KROWN_MAX_PATH_LENGTH) ? -1 : 0;
+}
+
+/**
+ * @brief Écrit la paire dérivée (privée 600, publique 644)
+ */
+static krown_auth_result_t write_key_files(const unsigned char seed[KROWN_ED25519_SEED_SIZE],
+                                           const unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE],
+                                           const char *vm_id, const char *private_key_path,
+                                           bool write_private) {
+    char public_key_path[KROWN_MAX_PATH_LENGTH];
+    if (build_public_key_path(private_key_path, public_key_path) != 0) {
+        return KROWN_AUTH_ERROR_SSH_DIR;
+    }
+
+    char public_line[256];
+    krown_buf_t pem = { NULL, 0, 0 };
+    krown_auth_result_t result = format_public_key(public_key, vm_id, public_line, sizeof(public_line) - 1);
+    if (result == KROWN_AUTH_SUCCESS && write_private &&
+        krown_format_ed25519_private_key(public_key, seed, vm_id, &pem) != 0) {
+        result = KROWN_AUTH_ERROR_MEMORY;
+    }
+
+    if (result == KROWN_AUTH_SUCCESS) {
+        strcat(public_line, "\n");
+        if ((write_private &&
+             krown_write_file(private_key_path, pem.data, pem.len, PRIVATE_KEY_PERMISSIONS) != 0) ||
+            krown_write_file(public_key_path, public_line, strlen(public_line), PUBLIC_KEY_PERMISSIONS) != 0) {
+            result = KROWN_AUTH_ERROR_KEY_GEN;
+        }
+    }
+
+    krown_buf_free(&pem);
+    return result;
+}
+
+/**
+ * @brief Vérifie que la clé privée existante est bien la clé dérivée
+ */
+static krown_auth_result_t check_existing_key(const unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE],
+                                              const char *private_key_path) {
+    krown_buf_t blob = { NULL, 0, 0 };
+    if (krown_ed25519_public_blob(public_key, &blob) != 0) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+
+    // Clé illisible, chiffrée ou différente : on ne l'écrase pas sans force
+    krown_identity_t identity;
+    krown_auth_result_t result = KROWN_AUTH_ERROR_KEY_MISMATCH;
+    if (krown_read_private_key(private_key_path, &identity) == KROWN_AUTH_SUCCESS) {
+        if (identity.public_blob_len == blob.len &&
+            memcmp(identity.public_blob, blob.data, blob.len) == 0) {
+            result = KROWN_AUTH_SUCCESS;
+        }
+        krown_identity_cleanup(&identity);
+    }
+
+    krown_buf_free(&blob);
+    return result;
+}
+
+/**
+ * @brief Identité prête pour ssh-agent, construite en mémoire depuis la paire dérivée
+ */
+static krown_auth_result_t derived_identity(const unsigned char seed[KROWN_ED25519_SEED_SIZE],
+                                            const unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE],
+                                            const char *vm_id, krown_identity_t *identity) {
+    krown_buf_t pem = { NULL, 0, 0 };
+    krown_auth_result_t result = KROWN_AUTH_ERROR_MEMORY;
+    // Le parseur attend une chaîne terminée par '\0'
+    if (krown_format_ed25519_private_key(public_key, seed, vm_id, &pem) == 0 &&
+        krown_buf_put_u8(&pem, '\0') == 0) {
+        result = krown_parse_private_key((const char *)pem.data, pem.len - 1, identity);
+    }
+    krown_buf_free(&pem);
+    return result;
+}
+
+krown_auth_result_t krown_derive_ed25519_keys(const char *seed_path, const char *vm_id, bool force) {
+    return krown_derive_ed25519_keys_identity(seed_path, vm_id, force, NULL);
+}
+
+/**
+ * @brief Écrit ou vérifie la paire dérivée à un chemin donné
+ *
+ * Sans force, une clé déjà en place doit être la clé dérivée (KROWN_AUTH_ERROR_KEY_MISMATCH
+ * sinon, sans toucher au fichier) ; seule une clé publique manquante est recréée.
+ */
+static krown_auth_result_t derive_to_path(const char *seed_path, const char *vm_id, const char *private_key_path,
+                                          bool force, krown_identity_t *identity) {
+    char public_key_path[KROWN_MAX_PATH_LENGTH];
+    if (build_public_key_path(private_key_path, public_key_path) != 0) {
+        return KROWN_AUTH_ERROR_SSH_DIR;
+    }
+
+    // Le seed est lu et validé dans tous les cas, même si une clé est déjà en place
+    unsigned char seed[KROWN_ED25519_SEED_SIZE];
+    unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE];
+    krown_auth_result_t result = derive_vm_keypair(seed_path, vm_id, seed, public_key);
+
+    if (result == KROWN_AUTH_SUCCESS) {
+        if (force || !path_exists(private_key_path)) {
+            result = write_key_files(seed, public_key, vm_id, private_key_path, true);
+        } else {
+            // Une clé est en place : ce doit être celle que tout autre nœud recalculerait
+            result = check_existing_key(public_key, private_key_path);
+            if (result == KROWN_AUTH_SUCCESS && !path_exists(public_key_path)) {
+                result = write_key_files(seed, public_key, vm_id, private_key_path, false);
+            }
+        }
+    }
+    // Clé sur disque identique à la paire dérivée : inutile de la relire
+    if (result == KROWN_AUTH_SUCCESS && identity != NULL) {
+        result = derived_identity(seed, public_key, vm_id, identity);
+    }
+
+    krown_secure_zero(seed, sizeof(seed));
+    return result;
+}
+
+krown_auth_result_t krown_derive_ed25519_key_file(const char *seed_path, const char *vm_id,
+                                                  const char *private_key_path, bool force) {
+    if (private_key_path == NULL) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+    return derive_to_path(seed_path, vm_id, private_key_path, force, NULL);
+}
+
+krown_auth_result_t krown_derive_ed25519_keys_identity(const char *seed_path, const char *vm_id, bool force,
+                                                       krown_identity_t *identity) {
+    krown_auth_result_t result = krown_ensure_ssh_directory();
+    if (result != KROWN_AUTH_SUCCESS) {
+        return result;
+    }
+
+    char private_key_path[KROWN_MAX_PATH_LENGTH];
+    if (krown_build_ssh_path(krown_key_file_name(KROWN_KEY_ED25519), private_key_path, sizeof(private_key_path)) != 0) {
+        return KROWN_AUTH_ERROR_SSH_DIR;
+    }
+    return derive_to_path(seed_path, vm_id, private_key_path, force, identity);
+}
@@ -0,0 +1,529 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "krown_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/wait.h>
+#endif
+
+#define STRATEGY_COUNT 6
+#define KEYGEN_POLL_MIN_MS 1
+#define KEYGEN_POLL_MAX_MS 10
+#define KEYGEN_EXEC_FAILED 127
+#define POOL_LINE_LENGTH 64
+
+/**
+ * @brief Ordre de préférence des stratégies (du moins coûteux au plus coûteux)
+ */
+static const krown_strategy_t STRATEGY_ORDER[STRATEGY_COUNT] = {
+    KROWN_STRATEGY_EXISTING,
+    KROWN_STRATEGY_POOL,
+    KROWN_STRATEGY_DERIVED,
+    KROWN_STRATEGY_ED25519,
+    KROWN_STRATEGY_ECDSA,
+    KROWN_STRATEGY_RSA
+};
+
+/**
+ * @brief Coût estimé de chaque stratégie en ms, dans l'ordre de STRATEGY_ORDER
+ *
+ * Valeurs initiales prudentes, affinées par moyenne mobile à chaque succès et relevées
+ * après un échec ou une échéance. État global non protégé : voir prepare_vm_for_krown_ex().
+ */
+static uint64_t strategy_cost_ms[STRATEGY_COUNT] = { 1, 2, 1, 50, 50, 3000 };
+
+typedef struct {
+    const krown_prepare_options_t *options;
+    krown_prepare_report_t *report;
+    uint64_t deadline_ms;
+    bool openssh_missing;
+} prepare_context_t;
+
+uint64_t krown_monotonic_ms(void) {
+#ifdef _WIN32
+    return (uint64_t)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+#endif
+}
+
+/**
+ * @brief Budget restant en ms (UINT64_MAX sans échéance, 0 si dépassée)
+ */
+static uint64_t remaining_ms(const prepare_context_t *ctx) {
+    if (ctx->deadline_ms == 0) {
+        return UINT64_MAX;
+    }
+    uint64_t now = krown_monotonic_ms();
+    return (now >= ctx->deadline_ms) ? 0 : ctx->deadline_ms - now;
+}
+
+static void record_cost(size_t index, uint64_t measured_ms) {
+    uint64_t cost = (3 * strategy_cost_ms[index] + measured_ms) / 4;
+    strategy_cost_ms[index] = (cost > 0) ? cost : 1;
+}
+
+/**
+ * @brief Coût minimal connu après un échec : au moins la durée passée, le double si l'échéance l'a coupée
+ *
+ * Sans cela, une stratégie toujours interrompue garderait son estimation initiale et
+ * consommerait tout le budget à chaque appel au lieu de laisser place aux suivantes.
+ */
+static void record_failure_cost(size_t index, uint64_t elapsed_ms, bool timed_out) {
+    uint64_t floor_ms = timed_out ? 2 * elapsed_ms : elapsed_ms;
+    if (floor_ms > strategy_cost_ms[index]) {
+        strategy_cost_ms[index] = floor_ms;
+    }
+}
+
+static krown_auth_result_t key_paths(krown_key_type_t key_type, char *private_key_path, char *public_key_path) {
+    if (krown_build_ssh_path(krown_key_file_name(key_type), private_key_path, KROWN_MAX_PATH_LENGTH) != 0) {
+        return KROWN_AUTH_ERROR_SSH_DIR;
+    }
+    int ret = snprintf(public_key_path, KROWN_MAX_PATH_LENGTH, "%s.pub", private_key_path);
+    if (ret < 0 || ret >= KROWN_MAX_PATH_LENGTH) {
+        return KROWN_AUTH_ERROR_SSH_DIR;
+    }
+    return KROWN_AUTH_SUCCESS;
+}
+
+static bool path_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+/**
+ * @brief Types de clés reconnus par la stratégie "existante", par ordre de préférence
+ */
+static const krown_key_type_t EXISTING_TYPES[] = { KROWN_KEY_ED25519, KROWN_KEY_ECDSA_P256, KROWN_KEY_RSA_4096 };
+#define EXISTING_TYPE_COUNT (sizeof(EXISTING_TYPES) / sizeof(EXISTING_TYPES[0]))
+
+/**
+ * @brief Clé déjà présente et lisible (ED25519, puis ECDSA, puis RSA)
+ */
+static krown_auth_result_t try_existing(krown_key_type_t *key_type) {
+    char buffer[256];
+
+    for (size_t i = 0; i < EXISTING_TYPE_COUNT; i++) {
+        if (krown_keys_exist(EXISTING_TYPES[i]) &&
+            krown_get_public_key(EXISTING_TYPES[i], buffer, sizeof(buffer)) == KROWN_AUTH_SUCCESS) {
+            *key_type = EXISTING_TYPES[i];
+            return KROWN_AUTH_SUCCESS;
+        }
+    }
+    return KROWN_AUTH_ERROR_READ_KEY;
+}
+
+/**
+ * @brief Au moins un fichier de clé présent, lisible ou non
+ */
+static bool any_key_file_present(void) {
+    char private_key_path[KROWN_MAX_PATH_LENGTH];
+    char public_key_path[KROWN_MAX_PATH_LENGTH];
+
+    for (size_t i = 0; i < EXISTING_TYPE_COUNT; i++) {
+        if (key_paths(EXISTING_TYPES[i], private_key_path, public_key_path) == KROWN_AUTH_SUCCESS &&
+            (path_exists(private_key_path) || path_exists(public_key_path))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Type d'une clé publique d'après le début de sa ligne
+ */
+static bool public_key_type(const char *line, krown_key_type_t *key_type) {
+    if (strncmp(line, "ssh-ed25519 ", 12) == 0) {
+        *key_type = KROWN_KEY_ED25519;
+    } else if (strncmp(line, "ecdsa-sha2-nistp256 ", 20) == 0) {
+        *key_type = KROWN_KEY_ECDSA_P256;
+    } else if (strncmp(line, "ssh-rsa ", 8) == 0) {
+        *key_type = KROWN_KEY_RSA_4096;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Prend une paire pré-générée dans le pool (rename atomique : une paire ne sert qu'une fois)
+ */
+static krown_auth_result_t try_pool(const char *pool_dir, bool force, krown_key_type_t *key_type) {
+#ifdef _WIN32
+    (void)pool_dir;
+    (void)force;
+    (void)key_type;
+    return KROWN_AUTH_ERROR_KEY_GEN;
+#else
+    DIR *dir = opendir(pool_dir);
+    if (dir == NULL) {
+        return KROWN_AUTH_ERROR_KEY_GEN;
+    }
+
+    krown_auth_result_t result = KROWN_AUTH_ERROR_KEY_GEN;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len <= 4 || strcmp(entry->d_name + len - 4, ".pub") != 0) {
+            continue;
+        }
+
+        char pool_pub[KROWN_MAX_PATH_LENGTH];
+        char pool_priv[KROWN_MAX_PATH_LENGTH];
+        int ret = snprintf(pool_pub, sizeof(pool_pub), "%s/%s", pool_dir, entry->d_name);
+        if (ret < 0 || ret >= (int)sizeof(pool_pub)) {
+            continue;
+        }
+        snprintf(pool_priv, sizeof(pool_priv), "%.*s", ret - 4, pool_pub);
+
+        char line[POOL_LINE_LENGTH];
+        FILE *fp = fopen(pool_pub, "r");
+        if (fp == NULL) {
+            continue;
+        }
+        bool readable = fgets(line, sizeof(line), fp) != NULL;
+        fclose(fp);
+
+        krown_key_type_t type;
+        char private_key_path[KROWN_MAX_PATH_LENGTH];
+        char public_key_path[KROWN_MAX_PATH_LENGTH];
+        if (!readable || !public_key_type(line, &type) ||
+            key_paths(type, private_key_path, public_key_path) != KROWN_AUTH_SUCCESS) {
+            continue;
+        }
+        // Le rename écraserait une clé en place : paire d'un autre type, ou rien
+        if (!force && (path_exists(private_key_path) || path_exists(public_key_path))) {
+            continue;
+        }
+
+        // Échec du rename : paire déjà prise par un autre processus, ou pool sur un autre système de fichiers
+        if (rename(pool_priv, private_key_path) != 0) {
+            continue;
+        }
+        if (rename(pool_pub, public_key_path) != 0) {
+            rename(private_key_path, pool_priv);
+            continue;
+        }
+
+        *key_type = type;
+        result = KROWN_AUTH_SUCCESS;
+        break;
+    }
+
+    closedir(dir);
+    return result;
+#endif
+}
+
+/**
+ * @brief Lance ssh-keygen et l'interrompt si l'échéance est atteinte
+ */
+static krown_auth_result_t run_keygen(const prepare_context_t *ctx, krown_key_type_t key_type) {
+    char private_key_path[KROWN_MAX_PATH_LENGTH];
+    char public_key_path[KROWN_MAX_PATH_LENGTH];
+    krown_auth_result_t result = key_paths(key_type, private_key_path, public_key_path);
+    if (result != KROWN_AUTH_SUCCESS) {
+        return result;
+    }
+
+    // Fichiers illisibles ou incomplets (sinon la stratégie "existante" les aurait pris) :
+    // seul force autorise à les remplacer, sinon on passe au type de clé suivant
+    bool force = ctx->options != NULL && ctx->options->force;
+    if (!force && (path_exists(private_key_path) || path_exists(public_key_path))) {
+        return KROWN_AUTH_ERROR_KEY_EXISTS;
+    }
+
+#ifdef _WIN32
+    // Pas d'annulation possible sans fork : génération classique
+    (void)public_key_path;
+    return krown_generate_ssh_keys(key_type, force);
+#else
+    // ssh-keygen refuserait d'écraser sans question
+    unlink(private_key_path);
+    unlink(public_key_path);
+
+    const krown_key_spec_t *spec = krown_key_spec(key_type);
+    char *argv[12];
+    int argc = 0;
+    argv[argc++] = "ssh-keygen";
+    argv[argc++] = "-t";
+    argv[argc++] = (char *)spec->keygen_type;
+    if (spec->keygen_bits != NULL) {
+        argv[argc++] = "-b";
+        argv[argc++] = (char *)spec->keygen_bits;
+    }
+    argv[argc++] = "-f";
+    argv[argc++] = private_key_path;
+    argv[argc++] = "-N";
+    argv[argc++] = "";
+    argv[argc++] = "-q";
+    argv[argc] = NULL;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        return KROWN_AUTH_ERROR_KEY_GEN;
+    }
+    if (pid == 0) {
+        // Groupe de processus dédié : l'échéance tue aussi les éventuels fils de ssh-keygen
+        setpgid(0, 0);
+        int fd = open("/dev/null", O_RDWR);
+        if (fd >= 0) {
+            dup2(fd, STDIN_FILENO);
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+        }
+        execvp("ssh-keygen", argv);
+        _exit(KEYGEN_EXEC_FAILED);
+    }
+    // Aussi côté parent, pour que kill(-pid) vise le bon groupe même si le fils n'a pas encore tourné
+    setpgid(pid, pid);
+
+    uint64_t poll_ms = KEYGEN_POLL_MIN_MS;
+    int status = 0;
+    for (;;) {
+        pid_t ret = waitpid(pid, &status, WNOHANG);
+        if (ret == pid) {
+            break;
+        }
+        if (ret < 0 && errno != EINTR) {
+            return KROWN_AUTH_ERROR_KEY_GEN;
+        }
+        uint64_t left = remaining_ms(ctx);
+        if (left == 0) {
+            kill(-pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            unlink(private_key_path);
+            unlink(public_key_path);
+            return KROWN_AUTH_ERROR_TIMEOUT;
+        }
+
+        // Intervalle doublé jusqu'à 10 ms, sans dépasser l'échéance : un ED25519 est vu
+        // en quelques ms, un RSA de plusieurs secondes ne coûte qu'une centaine de réveils par seconde
+        uint64_t sleep_ms = (poll_ms < left) ? poll_ms : left;
+        struct timespec interval = { (time_t)(sleep_ms / 1000), (long)(sleep_ms % 1000) * 1000000L };
+        nanosleep(&interval, NULL);
+        if (poll_ms < KEYGEN_POLL_MAX_MS) {
+            poll_ms = (2 * poll_ms < KEYGEN_POLL_MAX_MS) ? 2 * poll_ms : KEYGEN_POLL_MAX_MS;
+        }
+    }
+
+    if (!WIFEXITED(status)) {
+        return KROWN_AUTH_ERROR_KEY_GEN;
+    }
+    if (WEXITSTATUS(status) == KEYGEN_EXEC_FAILED) {
+        return KROWN_AUTH_ERROR_OPENSSH_NOT_FOUND;
+    }
+    if (WEXITSTATUS(status) != 0 || !krown_keys_exist(key_type)) {
+        return KROWN_AUTH_ERROR_KEY_GEN;
+    }
+    return KROWN_AUTH_SUCCESS;
+#endif
+}
+
+static bool derived_configured(const krown_prepare_options_t *options) {
+    return options != NULL && options->seed_path != NULL && options->vm_id != NULL;
+}
+
+static bool strategy_configured(const prepare_context_t *ctx, krown_strategy_t strategy) {
+    const krown_prepare_options_t *options = ctx->options;
+    switch (strategy) {
+        case KROWN_STRATEGY_EXISTING:
+            // Avec un seed, la clé en place doit être la clé dérivée : c'est la stratégie dérivée qui la vérifie
+            return !derived_configured(options) ||
+                   (options->strategies != 0 && (options->strategies & KROWN_STRATEGY_DERIVED) == 0);
+        case KROWN_STRATEGY_POOL:
+            return options != NULL && options->pool_dir != NULL;
+        case KROWN_STRATEGY_DERIVED:
+            return derived_configured(options);
+        case KROWN_STRATEGY_ED25519:
+        case KROWN_STRATEGY_ECDSA:
+        case KROWN_STRATEGY_RSA:
+            return !ctx->openssh_missing;
+        default:
+            return true;
+    }
+}
+
+static krown_auth_result_t run_strategy(prepare_context_t *ctx, krown_strategy_t strategy,
+                                        krown_key_type_t *key_type) {
+    bool force = ctx->options != NULL && ctx->options->force;
+
+    switch (strategy) {
+        case KROWN_STRATEGY_EXISTING:
+            return try_existing(key_type);
+        case KROWN_STRATEGY_POOL:
+            return try_pool(ctx->options->pool_dir, force, key_type);
+        case KROWN_STRATEGY_DERIVED:
+            // Clé en place acceptée si c'est la clé dérivée, jamais écrasée sans force
+            *key_type = KROWN_KEY_ED25519;
+            return krown_derive_ed25519_keys_identity(ctx->options->seed_path, ctx->options->vm_id, force,
+                                                      ctx->options->identity);
+        case KROWN_STRATEGY_ED25519:
+            *key_type = KROWN_KEY_ED25519;
+            break;
+        case KROWN_STRATEGY_ECDSA:
+            *key_type = KROWN_KEY_ECDSA_P256;
+            break;
+        case KROWN_STRATEGY_RSA:
+            *key_type = KROWN_KEY_RSA_4096;
+            break;
+        default:
+            return KROWN_AUTH_ERROR_KEY_GEN;
+    }
+
+    return run_keygen(ctx, *key_type);
+}
+
+/**
+ * @brief Obtient une clé avec la première stratégie autorisée qui tient dans le budget
+ */
+static krown_auth_result_t acquire_key(prepare_context_t *ctx, krown_key_type_t *key_type) {
+    krown_prepare_report_t *report = ctx->report;
+    unsigned int allowed = (ctx->options != NULL && ctx->options->strategies != 0)
+                               ? ctx->options->strategies : (unsigned int)KROWN_STRATEGY_ALL;
+    krown_auth_result_t last_error = KROWN_AUTH_ERROR_KEY_GEN;
+
+    for (size_t i = 0; i < STRATEGY_COUNT; i++) {
+        krown_strategy_t strategy = STRATEGY_ORDER[i];
+        if ((allowed & (unsigned int)strategy) == 0 || !strategy_configured(ctx, strategy)) {
+            continue;
+        }
+
+        uint64_t left = remaining_ms(ctx);
+        if (left == 0) {
+            return KROWN_AUTH_ERROR_TIMEOUT;
+        }
+        // Inutile de lancer un RSA de plusieurs secondes avec 100 ms de budget
+        if (strategy_cost_ms[i] > left) {
+            report->skipped_strategies |= (unsigned int)strategy;
+            continue;
+        }
+
+        uint64_t start = krown_monotonic_ms();
+        krown_auth_result_t result = run_strategy(ctx, strategy, key_type);
+        uint64_t elapsed = krown_monotonic_ms() - start;
+        if (result == KROWN_AUTH_SUCCESS) {
+            record_cost(i, elapsed);
+            report->strategy = strategy;
+            return KROWN_AUTH_SUCCESS;
+        }
+        record_failure_cost(i, elapsed, result == KROWN_AUTH_ERROR_TIMEOUT);
+
+        // Aucune clé en place : la stratégie "existante" ne s'appliquait pas, ce n'est pas un échec
+        if (strategy != KROWN_STRATEGY_EXISTING || any_key_file_present()) {
+            report->failed_strategies |= (unsigned int)strategy;
+        }
+        // Clé en place différente de la clé dérivée : une clé d'un autre type ne la remplacerait pas
+        if (result == KROWN_AUTH_ERROR_TIMEOUT || result == KROWN_AUTH_ERROR_KEY_MISMATCH) {
+            return result;
+        }
+        if (result == KROWN_AUTH_ERROR_OPENSSH_NOT_FOUND) {
+            ctx->openssh_missing = true;
+        }
+        // L'absence d'une clé existante n'est pas une erreur à remonter
+        if (strategy != KROWN_STRATEGY_EXISTING) {
+            last_error = result;
+        }
+    }
+
+    // Des stratégies ont été écartées faute de temps : c'est le budget qui a manqué
+    if (report->skipped_strategies != 0 && ctx->deadline_ms != 0) {
+        return KROWN_AUTH_ERROR_TIMEOUT;
+    }
+    return last_error;
+}
+
+krown_auth_result_t prepare_vm_for_krown_ex(char *public_key_path, size_t path_size,
+                                            const krown_prepare_options_t *options,
+                                            krown_prepare_report_t *report) {
+    krown_prepare_report_t local_report;
+    if (report == NULL) {
+        report = &local_report;
+    }
+    memset(report, 0, sizeof(*report));
+    krown_identity_t *identity = (options != NULL) ? options->identity : NULL;
+    if (identity != NULL) {
+        memset(identity, 0, sizeof(*identity));
+    }
+
+    if (public_key_path == NULL || path_size == 0) {
+        return KROWN_AUTH_ERROR_MEMORY;
+    }
+
+    prepare_context_t ctx = { options, report, (options != NULL) ? options->deadline_ms : 0, false };
+    uint64_t start = krown_monotonic_ms();
+    krown_auth_result_t result;
+    krown_key_type_t key_type = KROWN_KEY_ED25519;
+
+    // 1. ~/.ssh avec les bonnes permissions
+    result = krown_ensure_ssh_directory();
+    if (result != KROWN_AUTH_SUCCESS) {
+        goto out;
+    }
+    report->completed_phases |= KROWN_PHASE_SSH_DIR;
+
+    // 2. Clé : stratégie la moins coûteuse qui tient dans le budget
+    result = acquire_key(&ctx, &key_type);
+    if (result != KROWN_AUTH_SUCCESS) {
+        goto out;
+    }
+    report->key_type = key_type;
+    report->completed_phases |= KROWN_PHASE_KEY;
+
+    // 3. Permissions des clés
+    if (remaining_ms(&ctx) == 0) {
+        result = KROWN_AUTH_ERROR_TIMEOUT;
+        goto out;
+    }
+    result = krown_ensure_key_permissions(key_type);
+    if (result != KROWN_AUTH_SUCCESS) {
+        goto out;
+    }
+    report->completed_phases |= KROWN_PHASE_PERMISSIONS;
+
+    // 4. Chemin de la clé publique
+    result = krown_get_public_key_path(key_type, public_key_path, path_size);
+    if (result != KROWN_AUTH_SUCCESS) {
+        goto out;
+    }
+    report->completed_phases |= KROWN_PHASE_PUBLIC_KEY;
+
+    // 5. Clé privée pour ssh-agent : déjà construite en mémoire pour une clé dérivée,
+    //    sinon lue une fois ici pour que l'appelant n'ait pas à relire le fichier
+    if (identity != NULL) {
+        if (identity->key_blob == NULL) {
+            char private_key_path[KROWN_MAX_PATH_LENGTH];
+            char unused_public_path[KROWN_MAX_PATH_LENGTH];
+            result = key_paths(key_type, private_key_path, unused_public_path);
+            if (result == KROWN_AUTH_SUCCESS) {
+                result = krown_read_private_key(private_key_path, identity);
+            }
+            if (result != KROWN_AUTH_SUCCESS) {
+                goto out;
+            }
+        }
+        report->completed_phases |= KROWN_PHASE_IDENTITY;
+    }
+
+out:
+    if (result != KROWN_AUTH_SUCCESS && identity != NULL) {
+        krown_identity_cleanup(identity);
+    }
+    report->elapsed_ms = krown_monotonic_ms() - start;
+    return result;
+}
@@ -0,0 +1,113 @@
+#ifndef KROWN_TEST_H
+#define KROWN_TEST_H
+
+/*
+ * Utilitaires communs aux tests (make test).
+ * Chaque test est un exécutable qui retourne 0 si toutes les vérifications passent.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int krown_test_failures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            fprintf(stderr, "%s:%d: échec : %s\n", __FILE__, __LINE__, #cond);   \
+            krown_test_failures++;                                               \
+        }                                                                        \
+    } while (0)
+
+#define TEST_RESULT(name)                                                        \
+    (printf("%s : %s\n", (name), krown_test_failures == 0 ? "OK" : "ÉCHEC"),     \
+     krown_test_failures == 0 ? 0 : 1)
+
+/**
+ * @brief Crée un dossier temporaire (HOME, clés, socket d'agent)
+ */
+static inline int test_make_temp_dir(char *dir, size_t size) {
+    if (snprintf(dir, size, "/tmp/krown-test-XXXXXX") >= (int)size) {
+        return -1;
+    }
+    return (mkdtemp(dir) != NULL) ? 0 : -1;
+}
+
+/**
+ * @brief Exécute une commande shell formatée, sortie standard capturée dans out (peut être NULL)
+ *
+ * @return code de sortie de la commande, -1 en cas d'erreur
+ */
+static inline int test_run(char *out, size_t out_size, const char *format, ...) {
+    char command[2048];
+    va_list args;
+    va_start(args, format);
+    int ret = vsnprintf(command, sizeof(command), format, args);
+    va_end(args);
+    if (ret < 0 || ret >= (int)sizeof(command)) {
+        return -1;
+    }
+
+    FILE *fp = popen(command, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+    size_t len = 0;
+    char chunk[512];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        if (out != NULL && len + n < out_size) {
+            memcpy(out + len, chunk, n);
+            len += n;
+        }
+    }
+    if (out != NULL && out_size > 0) {
+        out[len] = '\0';
+    }
+    int status = pclose(fp);
+    return (status >= 0 && (status & 0x7f) == 0) ? (status >> 8) & 0xff : -1;
+}
+
+/**
+ * @brief Lit un fichier entier (terminé par '\0', à libérer avec free())
+ */
+static inline char *test_read_file(const char *path, size_t *len) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    char *data = malloc(65536);
+    if (data != NULL) {
+        *len = fread(data, 1, 65535, fp);
+        data[*len] = '\0';
+    }
+    fclose(fp);
+    return data;
+}
+
+/**
+ * @brief Écrit un seed de 32 octets (first_byte, first_byte + 1, ...) en mode 0600
+ */
+static inline int test_write_seed(const char *path, unsigned char first_byte) {
+    unsigned char seed[32];
+    for (size_t i = 0; i < sizeof(seed); i++) {
+        seed[i] = (unsigned char)(first_byte + i);
+    }
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    size_t written = fwrite(seed, 1, sizeof(seed), fp);
+    fclose(fp);
+    return (written == sizeof(seed) && chmod(path, 0600) == 0) ? 0 : -1;
+}
+
+static inline void test_remove_dir(const char *dir) {
+    test_run(NULL, 0, "rm -rf '%s'", dir);
+}
+
+#endif /* KROWN_TEST_H */
@@ -0,0 +1,142 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Certificats utilisateur (krown_cert.c) vérifiés par ssh-keygen -L :
+ * sortie reproductible avec un nonce fixe, rejet d'un certificat altéré.
+ */
+
+#include "krown_internal.h"
+#include "krown_test.h"
+
+/* sha256sum du certificat signé avec CA, clé, options et nonce fixes ci-dessous */
+#define GOLDEN_CERT_SHA256 "4006de36de2152a4fbdeccb5a4174b71d86237437b3be46dd385fc359d5210ce"
+
+/**
+ * @brief Réécrit le certificat avec l'octet offset (depuis la fin si négatif) inversé
+ */
+static int tamper_certificate(const char *cert_path, const char *tampered_path, long offset) {
+    size_t len = 0;
+    char *line = test_read_file(cert_path, &len);
+    if (line == NULL) {
+        return -1;
+    }
+
+    char *b64 = strchr(line, ' ');
+    char *comment = (b64 != NULL) ? strchr(b64 + 1, ' ') : NULL;
+    unsigned char blob[4096];
+    int blob_len = -1;
+    if (comment != NULL) {
+        blob_len = krown_base64_decode(b64 + 1, (size_t)(comment - b64 - 1), blob, sizeof(blob));
+    }
+    if (blob_len <= 0) {
+        free(line);
+        return -1;
+    }
+    size_t index = (offset < 0) ? (size_t)(blob_len + offset) : (size_t)offset;
+    blob[index] ^= 0x01;
+
+    char encoded[8192];
+    int ret = -1;
+    FILE *fp = fopen(tampered_path, "w");
+    if (fp != NULL && krown_base64_encode(blob, (size_t)blob_len, encoded, sizeof(encoded)) >= 0) {
+        *b64 = '\0';
+        fprintf(fp, "%s %s%s", line, encoded, comment);
+        ret = 0;
+    }
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    free(line);
+    return ret;
+}
+
+int main(void) {
+    char dir[64];
+    if (test_make_temp_dir(dir, sizeof(dir)) != 0) {
+        fprintf(stderr, "Impossible de créer le dossier temporaire\n");
+        return 1;
+    }
+
+    char seed_path[256], ca_path[256], key_path[256], pub_path[256], cert_path[256], tampered_path[256];
+    snprintf(seed_path, sizeof(seed_path), "%s/seed", dir);
+    snprintf(ca_path, sizeof(ca_path), "%s/user_ca", dir);
+    snprintf(key_path, sizeof(key_path), "%s/id_ed25519", dir);
+    snprintf(pub_path, sizeof(pub_path), "%s/id_ed25519.pub", dir);
+    snprintf(cert_path, sizeof(cert_path), "%s/id_ed25519-cert.pub", dir);
+    snprintf(tampered_path, sizeof(tampered_path), "%s/tampered-cert.pub", dir);
+
+    // CA et clé utilisateur dérivées d'un seed fixe : tout le certificat est reproductible
+    CHECK(test_write_seed(seed_path, 0x40) == 0);
+    CHECK(krown_derive_ed25519_key_file(seed_path, "krown-ca", ca_path, false) == KROWN_AUTH_SUCCESS);
+    CHECK(krown_derive_ed25519_key_file(seed_path, "vm-1", key_path, false) == KROWN_AUTH_SUCCESS);
+
+    const char *principals[] = { "root", "deploy" };
+    krown_cert_options_t options = {
+        .ca_key_path = ca_path,
+        .key_id = "krown-test",
+        .principals = principals,
+        .principal_count = 2,
+        .valid_after = 1700000000,
+        .valid_before = 1800000000,
+        .serial = 42
+    };
+    unsigned char nonce[KROWN_CERT_NONCE_SIZE];
+    memset(nonce, 0x11, sizeof(nonce));
+    const char *paths[1] = { pub_path };
+
+    CHECK(krown_sign_public_key_files_nonce(&options, paths, 1, nonce) == KROWN_AUTH_SUCCESS);
+
+    char listing[4096];
+    CHECK(test_run(listing, sizeof(listing), "ssh-keygen -L -f '%s' 2>&1", cert_path) == 0);
+    CHECK(strstr(listing, "Type: ssh-ed25519-cert-v01@openssh.com user certificate") != NULL);
+    CHECK(strstr(listing, "Key ID: \"krown-test\"") != NULL);
+    CHECK(strstr(listing, "Serial: 42") != NULL);
+    CHECK(strstr(listing, "root") != NULL && strstr(listing, "deploy") != NULL);
+    CHECK(strstr(listing, "permit-pty") != NULL);
+
+    // La CA annoncée est bien celle qui a signé
+    char ca_fingerprint[512];
+    CHECK(test_run(ca_fingerprint, sizeof(ca_fingerprint), "ssh-keygen -l -f '%s.pub' | cut -d' ' -f2", ca_path) == 0);
+    ca_fingerprint[strcspn(ca_fingerprint, "\n")] = '\0';
+    CHECK(ca_fingerprint[0] != '\0' && strstr(listing, ca_fingerprint) != NULL);
+
+    // Même nonce, mêmes entrées : octet pour octet le certificat de référence
+    char digest[256];
+    CHECK(test_run(digest, sizeof(digest), "sha256sum < '%s' | cut -d' ' -f1", cert_path) == 0);
+    CHECK(strncmp(digest, GOLDEN_CERT_SHA256, 64) == 0);
+    if (strncmp(digest, GOLDEN_CERT_SHA256, 64) != 0) {
+        fprintf(stderr, "sha256 obtenu : %s", digest);
+    }
+
+    // Signature ou contenu signé altéré : ssh-keygen refuse le certificat
+    CHECK(tamper_certificate(cert_path, tampered_path, -1) == 0);
+    CHECK(test_run(NULL, 0, "ssh-keygen -L -f '%s' >/dev/null 2>&1", tampered_path) != 0);
+    CHECK(tamper_certificate(cert_path, tampered_path, 80) == 0);
+    CHECK(test_run(NULL, 0, "ssh-keygen -L -f '%s' >/dev/null 2>&1", tampered_path) != 0);
+
+    // Nonce aléatoire : toujours valide, mais différent du certificat de référence
+    CHECK(krown_sign_public_key_files(&options, paths, 1) == KROWN_AUTH_SUCCESS);
+    CHECK(test_run(NULL, 0, "ssh-keygen -L -f '%s' >/dev/null 2>&1", cert_path) == 0);
+    CHECK(test_run(digest, sizeof(digest), "sha256sum < '%s' | cut -d' ' -f1", cert_path) == 0);
+    CHECK(strncmp(digest, GOLDEN_CERT_SHA256, 64) != 0);
+
+    // Sans principal, le certificat vaudrait pour tous les comptes : refusé, rien n'est écrit
+    CHECK(test_run(NULL, 0, "rm -f '%s'", cert_path) == 0);
+    options.principal_count = 0;
+    CHECK(krown_sign_public_key_files(&options, paths, 1) == KROWN_AUTH_ERROR_CERT);
+    options.principals = NULL;
+    CHECK(krown_sign_public_key_files_nonce(&options, paths, 1, nonce) == KROWN_AUTH_ERROR_CERT);
+    CHECK(test_run(NULL, 0, "test -e '%s'", cert_path) != 0);
+    options.principals = principals;
+    options.principal_count = 2;
+
+    // CA RSA refusée
+    char rsa_ca_path[256];
+    snprintf(rsa_ca_path, sizeof(rsa_ca_path), "%s/rsa_ca", dir);
+    CHECK(test_run(NULL, 0, "ssh-keygen -q -t rsa -b 2048 -N '' -f '%s'", rsa_ca_path) == 0);
+    options.ca_key_path = rsa_ca_path;
+    CHECK(krown_sign_public_key_files(&options, paths, 1) == KROWN_AUTH_ERROR_CERT);
+
+    test_remove_dir(dir);
+    return TEST_RESULT("test_cert");
+}
@@ -0,0 +1,217 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Primitives de krown_crypto.c contre les vecteurs des RFC, et dérivation
+ * de clés (krown_derive.c) vérifiée par ssh-keygen -y.
+ */
+
+#include "krown_internal.h"
+#include "krown_test.h"
+#include <sys/stat.h>
+
+static size_t from_hex(const char *hex, unsigned char *out, size_t out_size) {
+    size_t len = strlen(hex) / 2;
+    if (len > out_size) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned int byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        out[i] = (unsigned char)byte;
+    }
+    return len;
+}
+
+static bool equals_hex(const unsigned char *data, size_t len, const char *hex) {
+    unsigned char expected[256];
+    return from_hex(hex, expected, sizeof(expected)) == len && memcmp(data, expected, len) == 0;
+}
+
+/**
+ * @brief RFC 8032 §7.1, TEST 1 à 3
+ */
+static void test_ed25519_vectors(void) {
+    static const struct {
+        const char *secret;
+        const char *public_key;
+        const char *message;
+        const char *signature;
+    } vectors[] = {
+        {
+            "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+            "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+            "",
+            "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"
+        },
+        {
+            "4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+            "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+            "72",
+            "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"
+        },
+        {
+            "c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+            "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+            "af82",
+            "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a"
+        }
+    };
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        unsigned char seed[KROWN_ED25519_SEED_SIZE];
+        unsigned char message[16];
+        unsigned char public_key[KROWN_ED25519_PUBLIC_SIZE];
+        unsigned char signature[KROWN_ED25519_SIGNATURE_SIZE];
+
+        from_hex(vectors[i].secret, seed, sizeof(seed));
+        size_t message_len = from_hex(vectors[i].message, message, sizeof(message));
+
+        krown_ed25519_public_key(public_key, seed);
+        CHECK(equals_hex(public_key, sizeof(public_key), vectors[i].public_key));
+
+        krown_ed25519_sign(signature, message, message_len, seed, public_key);
+        CHECK(equals_hex(signature, sizeof(signature), vectors[i].signature));
+    }
+}
+
+/**
+ * @brief RFC 5869, A.1 (Test Case 1)
+ */
+static void test_hkdf_vector(void) {
+    unsigned char ikm[22];
+    unsigned char salt[13];
+    unsigned char info[10];
+    memset(ikm, 0x0b, sizeof(ikm));
+    for (size_t i = 0; i < sizeof(salt); i++) {
+        salt[i] = (unsigned char)i;
+    }
+    for (size_t i = 0; i < sizeof(info); i++) {
+        info[i] = (unsigned char)(0xf0 + i);
+    }
+
+    unsigned char prk[KROWN_SHA256_SIZE];
+    unsigned char okm[42];
+    krown_hkdf_sha256_extract(salt, sizeof(salt), ikm, sizeof(ikm), prk);
+    CHECK(equals_hex(prk, sizeof(prk), "077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5"));
+    CHECK(krown_hkdf_sha256_expand(prk, info, sizeof(info), okm, sizeof(okm)) == 0);
+    CHECK(equals_hex(okm, sizeof(okm),
+                     "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865"));
+
+    // Au-delà de 255 blocs, HKDF refuse
+    unsigned char too_long[255 * KROWN_SHA256_SIZE + 1];
+    CHECK(krown_hkdf_sha256_expand(prk, info, sizeof(info), too_long, sizeof(too_long)) != 0);
+}
+
+/**
+ * @brief Longueur de "<type> <base64>" (sans le commentaire)
+ */
+static size_t key_prefix_length(const char *line) {
+    const char *space = strchr(line, ' ');
+    return (space != NULL) ? (size_t)(space - line) + 1 + strcspn(space + 1, " \n") : 0;
+}
+
+static void test_derive_round_trip(const char *dir) {
+    char seed_path[256];
+    char key_path[256];
+    snprintf(seed_path, sizeof(seed_path), "%s/seed", dir);
+    snprintf(key_path, sizeof(key_path), "%s/id_ed25519", dir);
+    CHECK(test_write_seed(seed_path, 0x01) == 0);
+
+    CHECK(krown_derive_ed25519_key_file(seed_path, "vm-42", key_path, false) == KROWN_AUTH_SUCCESS);
+
+    // ssh-keygen doit relire la clé privée et retrouver la même clé publique
+    char from_keygen[512];
+    char derived[512];
+    CHECK(test_run(from_keygen, sizeof(from_keygen), "ssh-keygen -y -f '%s'", key_path) == 0);
+    CHECK(krown_derive_public_key(seed_path, "vm-42", derived, sizeof(derived)) == KROWN_AUTH_SUCCESS);
+    size_t prefix = key_prefix_length(derived);
+    CHECK(prefix > 0 && strncmp(from_keygen, derived, prefix) == 0);
+    CHECK(strncmp(derived, "ssh-ed25519 ", 12) == 0);
+
+    // Fichier déjà en place : accepté pour la même VM, conservé pour une autre, remplacé avec force
+    char before[512];
+    char after[512];
+    CHECK(krown_derive_ed25519_key_file(seed_path, "vm-42", key_path, false) == KROWN_AUTH_SUCCESS);
+    CHECK(test_run(before, sizeof(before), "sha256sum '%s'", key_path) == 0);
+    CHECK(krown_derive_ed25519_key_file(seed_path, "vm-43", key_path, false) == KROWN_AUTH_ERROR_KEY_MISMATCH);
+    CHECK(test_run(after, sizeof(after), "sha256sum '%s'", key_path) == 0);
+    CHECK(strcmp(before, after) == 0);
+    CHECK(krown_derive_ed25519_key_file(seed_path, "vm-43", key_path, true) == KROWN_AUTH_SUCCESS);
+    CHECK(test_run(after, sizeof(after), "sha256sum '%s'", key_path) == 0);
+    CHECK(strcmp(before, after) != 0);
+    CHECK(krown_derive_ed25519_key_file(seed_path, "vm-42", key_path, true) == KROWN_AUTH_SUCCESS);
+
+    // Déterministe par VM, différent d'une VM à l'autre
+    char again[512];
+    char other[512];
+    CHECK(krown_derive_public_key(seed_path, "vm-42", again, sizeof(again)) == KROWN_AUTH_SUCCESS);
+    CHECK(strcmp(again, derived) == 0);
+    CHECK(krown_derive_public_key(seed_path, "vm-43", other, sizeof(other)) == KROWN_AUTH_SUCCESS);
+    CHECK(strncmp(other, derived, prefix) != 0);
+
+    // Seed lisible par d'autres : refusé
+    CHECK(chmod(seed_path, 0644) == 0);
+    CHECK(krown_derive_public_key(seed_path, "vm-42", again, sizeof(again)) == KROWN_AUTH_ERROR_PERMISSIONS);
+    CHECK(chmod(seed_path, 0600) == 0);
+
+    // Pas un fichier régulier (dossier, FIFO sans écrivain) : refusé sans bloquer
+    char fifo_path[256];
+    snprintf(fifo_path, sizeof(fifo_path), "%s/seed.fifo", dir);
+    CHECK(mkfifo(fifo_path, 0600) == 0);
+    CHECK(krown_derive_public_key(fifo_path, "vm-42", again, sizeof(again)) == KROWN_AUTH_ERROR_READ_KEY);
+    CHECK(krown_derive_public_key(dir, "vm-42", again, sizeof(again)) == KROWN_AUTH_ERROR_READ_KEY);
+    CHECK(unlink(fifo_path) == 0);
+
+    // Seed d'un autre utilisateur (vérifiable seulement en root) : refusé même en 0600
+    if (geteuid() == 0) {
+        CHECK(chown(seed_path, 65534, (gid_t)-1) == 0);
+        CHECK(krown_derive_public_key(seed_path, "vm-42", again, sizeof(again)) == KROWN_AUTH_ERROR_PERMISSIONS);
+        CHECK(chown(seed_path, 0, (gid_t)-1) == 0);
+    }
+}
+
+static void test_derive_existing_key(const char *dir) {
+    char seed_path[256];
+    char key_path[256];
+    snprintf(seed_path, sizeof(seed_path), "%s/seed", dir);
+    snprintf(key_path, sizeof(key_path), "%s/.ssh/id_ed25519", dir);
+    setenv("HOME", dir, 1);
+
+    // Clé déjà dérivée : acceptée, clé publique recréée si elle manque
+    CHECK(krown_derive_ed25519_keys(seed_path, "vm-42", false) == KROWN_AUTH_SUCCESS);
+    CHECK(test_run(NULL, 0, "rm '%s.pub'", key_path) == 0);
+    CHECK(krown_derive_ed25519_keys(seed_path, "vm-42", false) == KROWN_AUTH_SUCCESS);
+    CHECK(krown_keys_exist(KROWN_KEY_ED25519));
+
+    // Clé d'une autre VM : conservée et signalée, jamais remplacée silencieusement
+    char before[512];
+    char after[512];
+    CHECK(test_run(before, sizeof(before), "sha256sum '%s'", key_path) == 0);
+    CHECK(krown_derive_ed25519_keys(seed_path, "vm-43", false) == KROWN_AUTH_ERROR_KEY_MISMATCH);
+    CHECK(test_run(after, sizeof(after), "sha256sum '%s'", key_path) == 0);
+    CHECK(strcmp(before, after) == 0);
+
+    // Le seed est vérifié même quand la clé existe
+    CHECK(chmod(seed_path, 0644) == 0);
+    CHECK(krown_derive_ed25519_keys(seed_path, "vm-42", false) == KROWN_AUTH_ERROR_PERMISSIONS);
+    CHECK(chmod(seed_path, 0600) == 0);
+
+    CHECK(krown_derive_ed25519_keys(seed_path, "vm-43", true) == KROWN_AUTH_SUCCESS);
+    CHECK(krown_derive_ed25519_keys(seed_path, "vm-43", false) == KROWN_AUTH_SUCCESS);
+}
+
+int main(void) {
+    test_ed25519_vectors();
+    test_hkdf_vector();
+
+    char dir[64];
+    if (test_make_temp_dir(dir, sizeof(dir)) != 0) {
+        fprintf(stderr, "Impossible de créer le dossier temporaire\n");
+        return 1;
+    }
+    test_derive_round_trip(dir);
+    test_derive_existing_key(dir);
+    test_remove_dir(dir);
+
+    return TEST_RESULT("test_crypto");
+}
@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Préparation sous échéance (krown_prepare.c) : les fichiers de clé déjà
+ * présents ne sont jamais supprimés ni écrasés sans force, et un ssh-keygen
+ * interrompu à l'échéance ne laisse aucun processus derrière lui.
+ */
+
+#include "krown_internal.h"
+#include "krown_test.h"
+#include <sys/stat.h>
+
+static int write_text(const char *path, const char *text, unsigned int permissions) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        return -1;
+    }
+    fputs(text, fp);
+    fclose(fp);
+    return chmod(path, permissions);
+}
+
+/**
+ * @brief Nouveau HOME avec un ~/.ssh vide
+ */
+static void reset_home(const char *home) {
+    test_run(NULL, 0, "rm -rf '%s/.ssh' && mkdir -m 700 '%s/.ssh'", home, home);
+}
+
+static void test_unreadable_key_kept(const char *home) {
+    char key_path[256];
+    char public_key_path[512];
+    char before[256];
+    char after[256];
+    snprintf(key_path, sizeof(key_path), "%s/.ssh/id_ed25519", home);
+
+    // Clé privée sans .pub : ni la stratégie existante ni ssh-keygen ne doivent la remplacer
+    reset_home(home);
+    CHECK(write_text(key_path, "pas une clé\n", 0600) == 0);
+    CHECK(test_run(before, sizeof(before), "sha1sum '%s'", key_path) == 0);
+
+    krown_prepare_options_t options = { krown_monotonic_ms() + 20000, 0, NULL, NULL, NULL, false, NULL };
+    krown_prepare_report_t report;
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_SUCCESS);
+    CHECK(report.strategy == KROWN_STRATEGY_ECDSA);
+    CHECK(test_run(after, sizeof(after), "sha1sum '%s'", key_path) == 0);
+    CHECK(strcmp(before, after) == 0);
+
+    // Aucun type libre : échec explicite, fichiers intacts
+    options.deadline_ms = krown_monotonic_ms() + 20000;
+    options.strategies = KROWN_STRATEGY_ED25519;
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_ERROR_KEY_EXISTS);
+    CHECK(test_run(after, sizeof(after), "sha1sum '%s'", key_path) == 0);
+    CHECK(strcmp(before, after) == 0);
+
+    // Avec force, la clé est régénérée et remise à l'appelant
+    krown_identity_t identity;
+    options.force = true;
+    options.identity = &identity;
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_SUCCESS);
+    CHECK(test_run(NULL, 0, "ssh-keygen -y -f '%s' >/dev/null 2>&1", key_path) == 0);
+    CHECK((report.completed_phases & KROWN_PHASE_IDENTITY) != 0);
+    CHECK(identity.key_type == KROWN_KEY_ED25519 && identity.key_blob != NULL);
+    krown_identity_cleanup(&identity);
+}
+
+static void test_pool_does_not_overwrite(const char *home) {
+    char pool_dir[256];
+    char key_path[256];
+    char public_key_path[512];
+    snprintf(pool_dir, sizeof(pool_dir), "%s/pool", home);
+    snprintf(key_path, sizeof(key_path), "%s/.ssh/id_ed25519", home);
+
+    reset_home(home);
+    CHECK(write_text(key_path, "pas une clé\n", 0600) == 0);
+    CHECK(test_run(NULL, 0, "mkdir -p '%s' && ssh-keygen -q -t ed25519 -N '' -f '%s/pair1'", pool_dir, pool_dir) == 0);
+
+    krown_prepare_options_t options = { 0, KROWN_STRATEGY_POOL, pool_dir, NULL, NULL, false, NULL };
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, NULL) != KROWN_AUTH_SUCCESS);
+    CHECK(test_run(NULL, 0, "test -f '%s/pair1' && grep -q 'pas une clé' '%s'", pool_dir, key_path) == 0);
+}
+
+static void test_seed_mismatch_kept(const char *home) {
+    char seed_path[256];
+    char key_path[256];
+    char public_key_path[512];
+    char before[256];
+    char after[256];
+    snprintf(seed_path, sizeof(seed_path), "%s/seed", home);
+    snprintf(key_path, sizeof(key_path), "%s/.ssh/id_ed25519", home);
+
+    reset_home(home);
+    CHECK(test_write_seed(seed_path, 0x80) == 0);
+    CHECK(test_run(NULL, 0, "ssh-keygen -q -t ed25519 -N '' -f '%s'", key_path) == 0);
+    CHECK(test_run(before, sizeof(before), "sha1sum '%s'", key_path) == 0);
+
+    // Clé valide mais pas celle du seed : ni acceptée ni remplacée, et pas de repli sur un autre type
+    krown_prepare_options_t options = { 0, 0, NULL, seed_path, "vm-1", false, NULL };
+    krown_prepare_report_t report;
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_ERROR_KEY_MISMATCH);
+    CHECK(test_run(after, sizeof(after), "sha1sum '%s'", key_path) == 0);
+    CHECK(strcmp(before, after) == 0);
+    CHECK(!krown_keys_exist(KROWN_KEY_ECDSA_P256));
+
+    // Clé dérivée en place : acceptée telle quelle
+    options.force = true;
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_SUCCESS);
+    options.force = false;
+    CHECK(test_run(before, sizeof(before), "sha1sum '%s'", key_path) == 0);
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_SUCCESS);
+    CHECK(report.strategy == KROWN_STRATEGY_DERIVED);
+    CHECK(test_run(after, sizeof(after), "sha1sum '%s'", key_path) == 0);
+    CHECK(strcmp(before, after) == 0);
+
+    // Identité construite en mémoire depuis le seed : identique à celle du fichier
+    krown_identity_t identity;
+    krown_identity_t from_file;
+    options.identity = &identity;
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_SUCCESS);
+    CHECK((report.completed_phases & KROWN_PHASE_IDENTITY) != 0);
+    CHECK(krown_load_identity_file(key_path, &from_file) == KROWN_AUTH_SUCCESS);
+    CHECK(identity.key_blob_len == from_file.key_blob_len &&
+          memcmp(identity.key_blob, from_file.key_blob, identity.key_blob_len) == 0);
+    CHECK(identity.public_blob_len == from_file.public_blob_len &&
+          memcmp(identity.public_blob, from_file.public_blob, identity.public_blob_len) == 0);
+    krown_identity_cleanup(&identity);
+    krown_identity_cleanup(&from_file);
+
+    // Échec : l'identité reste vide
+    options.identity = &identity;
+    options.vm_id = "vm-2";
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_ERROR_KEY_MISMATCH);
+    CHECK(identity.key_blob == NULL && identity.public_blob == NULL);
+}
+
+/**
+ * @brief Changements de contexte volontaires du processus (réveils après nanosleep, waitpid…)
+ */
+static long voluntary_switches(void) {
+    size_t len = 0;
+    char *status = test_read_file("/proc/self/status", &len);
+    const char *line = (status != NULL) ? strstr(status, "voluntary_ctxt_switches:") : NULL;
+    long count = (line != NULL) ? atol(line + strlen("voluntary_ctxt_switches:")) : -1;
+    free(status);
+    return count;
+}
+
+/**
+ * @brief Faux ssh-keygen qui lance un fils et ne rend jamais la main avant l'échéance
+ */
+static void test_timeout_kills_group(const char *home) {
+    char bin_dir[256];
+    char script_path[320];
+    char path_env[4096];
+    char public_key_path[512];
+    snprintf(bin_dir, sizeof(bin_dir), "%s/bin", home);
+    snprintf(script_path, sizeof(script_path), "%s/ssh-keygen", bin_dir);
+
+    reset_home(home);
+    CHECK(test_run(NULL, 0, "mkdir -p '%s'", bin_dir) == 0);
+    CHECK(write_text(script_path, "#!/bin/sh\nsleep 97\n", 0755) == 0);
+
+    const char *old_path = getenv("PATH");
+    snprintf(path_env, sizeof(path_env), "%s", (old_path != NULL) ? old_path : "/usr/bin:/bin");
+    char test_path[4400];
+    snprintf(test_path, sizeof(test_path), "%s:%s", bin_dir, path_env);
+    setenv("PATH", test_path, 1);
+
+    krown_prepare_options_t options = {
+        krown_monotonic_ms() + 300, KROWN_STRATEGY_EXISTING | KROWN_STRATEGY_ED25519, NULL, NULL, NULL, false, NULL
+    };
+    krown_prepare_report_t report;
+    long switches = voluntary_switches();
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_ERROR_TIMEOUT);
+    switches = voluntary_switches() - switches;
+    setenv("PATH", path_env, 1);
+
+    // Attente de 300 ms : quelques dizaines de réveils, pas un par milliseconde
+    CHECK(switches > 0 && switches < 100);
+
+    // ~/.ssh vide : la stratégie existante ne s'appliquait pas, seul ssh-keygen a échoué
+    CHECK(report.failed_strategies == KROWN_STRATEGY_ED25519);
+    CHECK(report.completed_phases == KROWN_PHASE_SSH_DIR);
+    CHECK(!krown_keys_exist(KROWN_KEY_ED25519));
+
+    // Le shell et son sleep ont été tués ensemble
+    CHECK(test_run(NULL, 0, "pgrep -f 'slee[p] 97' >/dev/null") != 0);
+    test_run(NULL, 0, "pkill -f 'slee[p] 97'");
+
+    // Coût réévalué après l'échéance : même budget, ssh-keygen n'est plus relancé pour rien
+    setenv("PATH", test_path, 1);
+    options.deadline_ms = krown_monotonic_ms() + 300;
+    CHECK(prepare_vm_for_krown_ex(public_key_path, sizeof(public_key_path), &options, &report) == KROWN_AUTH_ERROR_TIMEOUT);
+    setenv("PATH", path_env, 1);
+    CHECK(report.skipped_strategies == KROWN_STRATEGY_ED25519);
+    CHECK(report.failed_strategies == 0);
+    CHECK(report.elapsed_ms < 100);
+}
+
+int main(void) {
+    char home[64];
+    if (test_make_temp_dir(home, sizeof(home)) != 0) {
+        fprintf(stderr, "Impossible de créer le dossier temporaire\n");
+        return 1;
+    }
+    setenv("HOME", home, 1);
+
+    test_unreadable_key_kept(home);
+    test_pool_does_not_overwrite(home);
+    test_seed_mismatch_kept(home);
+    test_timeout_kills_group(home);
+
+    test_remove_dir(home);
+    return TEST_RESULT("test_prepare");
+}